@@ -55,7 +55,8 @@ CREATE TABLE `accounts_keys` (
   `public_key` varchar(64) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT '公钥',
   `permission` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT '权限名称',
   PRIMARY KEY (`id`),
-  KEY `account` (`account`)
+  UNIQUE KEY `idx_accounts_keys_key` (`public_key`,`account`,`permission`),
+  KEY `idx_accounts_keys_account_permission` (`account`,`permission`)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
 /*!40101 SET character_set_client = @saved_cs_client */;
 
@@ -67,10 +68,9 @@ DROP TABLE IF EXISTS `actions`;
 /*!40101 SET @saved_cs_client     = @@character_set_client */;
  SET character_set_client = utf8mb4 ;
 CREATE TABLE `actions` (
-  `id` bigint(20) NOT NULL AUTO_INCREMENT,
   `account` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT '合约拥有者账号',
   `transaction_id` varchar(64) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT '交易号',
-  `seq` smallint(6) NOT NULL DEFAULT '0' COMMENT '序列号',
+  `seq` int(11) NOT NULL DEFAULT '0' COMMENT '序列号',
   `parent` bigint(20) NOT NULL DEFAULT '0' COMMENT '',
   `name` varchar(64) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT 'action 名称',
   `created_at` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP COMMENT '创建时间',
@@ -82,7 +82,9 @@ CREATE TABLE `actions` (
   `payer` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT '提取 data 的 payer 字段',
   `newaccount` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT '新建账号名称',
   `sellram_account` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT '卖内存的用户名',
-  PRIMARY KEY (`id`),
+  `global_sequence` bigint(20) NOT NULL DEFAULT '0',
+  `block_num` int(11) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`global_sequence`),
   KEY `idx_actions_account` (`account`),
   KEY `idx_actions_name` (`name`),
   KEY `idx_actions_tx_id` (`transaction_id`),
@@ -96,6 +98,57 @@ CREATE TABLE `actions` (
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
 /*!40101 SET character_set_client = @saved_cs_client */;
 
+--
+-- Table structure for table `account_actions`
+--
+
+DROP TABLE IF EXISTS `account_actions`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `account_actions` (
+  `account` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `action_seq` bigint(20) NOT NULL DEFAULT '0',
+  `contract` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `name` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `block_num` int(11) NOT NULL DEFAULT '0',
+  `created_at` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  PRIMARY KEY (`account`,`action_seq`),
+  KEY `idx_account_contract_name` (`account`,`contract`,`name`),
+  KEY `idx_account_contract` (`account`,`contract`),
+  KEY `idx_account_block` (`account`,`block_num`),
+  KEY `idx_account_created` (`account`,`created_at`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+--
+-- Table structure for table `sync_status`
+--
+
+DROP TABLE IF EXISTS `sync_status`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `sync_status` (
+  `id` tinyint(4) NOT NULL DEFAULT '1',
+  `block_num` int(11) NOT NULL DEFAULT '0',
+  `updated_at` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  PRIMARY KEY (`id`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+--
+-- Table structure for table `shards`
+--
+
+DROP TABLE IF EXISTS `shards`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `shards` (
+  `shard` smallint(6) NOT NULL,
+  `uri` varchar(512) NOT NULL DEFAULT '',
+  PRIMARY KEY (`shard`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
 --
 -- Table structure for table `actions_accounts`
 --
@@ -216,7 +269,24 @@ CREATE TABLE `tokens` (
   `contract_owner` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT 'Token 合约拥有者',
   PRIMARY KEY (`id`),
   UNIQUE KEY `idx_symbol_owner_account` (`account`,`symbol`,`contract_owner`),
-  KEY `idx_tokens_account` (`account`)
+  KEY `idx_tokens_account` (`account`),
+  KEY `idx_tokens_contract_symbol_balance` (`contract_owner`,`symbol`,`balance`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+--
+-- Table structure for table `account_tokens`
+--
+
+DROP TABLE IF EXISTS `account_tokens`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `account_tokens` (
+  `id` bigint(20) NOT NULL AUTO_INCREMENT,
+  `account` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT '账号',
+  `contract` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '' COMMENT '收到过的 Token 合约',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `idx_account_contract` (`account`,`contract`)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
 /*!40101 SET character_set_client = @saved_cs_client */;
 
@@ -296,6 +366,105 @@ CREATE TABLE `proposal` (
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
 /*!40101 SET character_set_client = @saved_cs_client */;
 
+--
+-- Table structure for table `action_stats_hourly`
+--
+
+DROP TABLE IF EXISTS `action_stats_hourly`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `action_stats_hourly` (
+  `contract` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `action` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `hour` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  `actions` bigint(20) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`contract`,`action`,`hour`),
+  KEY `idx_action_stats_hour` (`hour`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+--
+-- Table structure for table `producer_stats_hourly`
+--
+
+DROP TABLE IF EXISTS `producer_stats_hourly`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `producer_stats_hourly` (
+  `producer` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `hour` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  `blocks` bigint(20) NOT NULL DEFAULT '0',
+  `transactions` bigint(20) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`producer`,`hour`),
+  KEY `idx_producer_stats_hour` (`hour`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+--
+-- Table structure for table `transfer_stats_hourly`
+--
+
+DROP TABLE IF EXISTS `transfer_stats_hourly`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `transfer_stats_hourly` (
+  `contract` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `symbol` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `hour` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  `transfers` bigint(20) NOT NULL DEFAULT '0',
+  `volume` bigint(20) NOT NULL DEFAULT '0',
+  `symbol_precision` int(11) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`contract`,`symbol`,`hour`),
+  KEY `idx_transfer_stats_hour` (`hour`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+--
+-- Table structure for table `producer_tally`
+--
+
+DROP TABLE IF EXISTS `producer_tally`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `producer_tally` (
+  `producer` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `voters` bigint(20) NOT NULL DEFAULT '0',
+  `staked` bigint(20) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`producer`),
+  KEY `idx_producer_tally_voters` (`voters`),
+  KEY `idx_producer_tally_staked` (`staked`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+--
+-- Table structure for table `voter_stakes`
+--
+
+DROP TABLE IF EXISTS `voter_stakes`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `voter_stakes` (
+  `voter` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `staked` bigint(20) DEFAULT NULL,
+  `producers` json DEFAULT NULL,
+  PRIMARY KEY (`voter`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+--
+-- Table structure for table `apply_status`
+--
+
+DROP TABLE IF EXISTS `apply_status`;
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+ SET character_set_client = utf8mb4 ;
+CREATE TABLE `apply_status` (
+  `name` varchar(32) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `global_sequence` bigint(20) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`name`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
 /*!40101 SET SQL_MODE=@OLD_SQL_MODE */;
 /*!40014 SET FOREIGN_KEY_CHECKS=@OLD_FOREIGN_KEY_CHECKS */;
 /*!40014 SET UNIQUE_CHECKS=@OLD_UNIQUE_CHECKS */;
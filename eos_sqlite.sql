@@ -0,0 +1,194 @@
+--
+-- Schema for running sql_db_plugin against sqlite3 (sql_db-uri sqlite3://...).
+-- Same tables and keys as eos.sql, except blocks, transactions and traces: only the trace writer
+-- supports sqlite3, and it never writes those. The api plugin is only tested against mysql.
+--
+
+CREATE TABLE IF NOT EXISTS accounts (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  name varchar(16) NOT NULL DEFAULT '',
+  abi text DEFAULT NULL,
+  created_at timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  updated_at timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  CONSTRAINT idx_accounts_name UNIQUE (name)
+);
+
+CREATE TABLE IF NOT EXISTS accounts_keys (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  account varchar(16) NOT NULL DEFAULT '',
+  public_key varchar(64) NOT NULL DEFAULT '',
+  permission varchar(16) NOT NULL DEFAULT ''
+);
+CREATE UNIQUE INDEX IF NOT EXISTS idx_accounts_keys_key ON accounts_keys (public_key, account, permission);
+CREATE INDEX IF NOT EXISTS idx_accounts_keys_account_permission ON accounts_keys (account, permission);
+
+CREATE TABLE IF NOT EXISTS actions (
+  account varchar(16) NOT NULL DEFAULT '',
+  transaction_id varchar(64) NOT NULL DEFAULT '',
+  seq integer NOT NULL DEFAULT 0,
+  parent bigint NOT NULL DEFAULT 0,
+  name varchar(64) NOT NULL DEFAULT '',
+  created_at timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  data text DEFAULT NULL,
+  "authorization" text DEFAULT NULL,
+  eosto varchar(16) NOT NULL DEFAULT '',
+  eosfrom varchar(16) NOT NULL DEFAULT '',
+  receiver varchar(16) NOT NULL DEFAULT '',
+  payer varchar(16) NOT NULL DEFAULT '',
+  newaccount varchar(16) NOT NULL DEFAULT '',
+  sellram_account varchar(16) NOT NULL DEFAULT '',
+  global_sequence bigint NOT NULL DEFAULT 0,
+  block_num integer NOT NULL DEFAULT 0,
+  PRIMARY KEY (global_sequence)
+);
+CREATE INDEX IF NOT EXISTS idx_actions_account ON actions (account);
+CREATE INDEX IF NOT EXISTS idx_actions_name ON actions (name);
+CREATE INDEX IF NOT EXISTS idx_actions_tx_id ON actions (transaction_id);
+CREATE INDEX IF NOT EXISTS idx_actions_created ON actions (created_at);
+CREATE INDEX IF NOT EXISTS idx_actions_eosto ON actions (eosto);
+CREATE INDEX IF NOT EXISTS idx_actions_eosfrom ON actions (eosfrom);
+CREATE INDEX IF NOT EXISTS idx_actions_receiver ON actions (receiver);
+CREATE INDEX IF NOT EXISTS idx_actions_payer ON actions (payer);
+CREATE INDEX IF NOT EXISTS idx_actions_newaccount ON actions (newaccount);
+CREATE INDEX IF NOT EXISTS idx_actions_sellram_account ON actions (sellram_account);
+
+CREATE TABLE IF NOT EXISTS account_actions (
+  account varchar(16) NOT NULL DEFAULT '',
+  action_seq bigint NOT NULL DEFAULT 0,
+  contract varchar(16) NOT NULL DEFAULT '',
+  name varchar(16) NOT NULL DEFAULT '',
+  block_num integer NOT NULL DEFAULT 0,
+  created_at timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  PRIMARY KEY (account, action_seq)
+);
+CREATE INDEX IF NOT EXISTS idx_account_contract_name ON account_actions (account, contract, name);
+CREATE INDEX IF NOT EXISTS idx_account_contract ON account_actions (account, contract);
+CREATE INDEX IF NOT EXISTS idx_account_block ON account_actions (account, block_num);
+CREATE INDEX IF NOT EXISTS idx_account_created ON account_actions (account, created_at);
+
+CREATE TABLE IF NOT EXISTS sync_status (
+  id INTEGER PRIMARY KEY DEFAULT 1,
+  block_num integer NOT NULL DEFAULT 0,
+  updated_at timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP
+);
+
+CREATE TABLE IF NOT EXISTS shards (
+  shard INTEGER PRIMARY KEY,
+  uri varchar(512) NOT NULL DEFAULT ''
+);
+
+CREATE TABLE IF NOT EXISTS assets (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  supply bigint NOT NULL DEFAULT 0,
+  max_supply bigint NOT NULL DEFAULT 0,
+  symbol_precision integer NOT NULL DEFAULT 0,
+  symbol varchar(16) NOT NULL DEFAULT '',
+  issuer varchar(16) NOT NULL DEFAULT '',
+  contract_owner varchar(16) NOT NULL DEFAULT '',
+  logo_url varchar(200) NOT NULL DEFAULT '',
+  CONSTRAINT idx_symbol_owner UNIQUE (symbol, contract_owner)
+);
+
+CREATE TABLE IF NOT EXISTS refunds (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  owner varchar(16) NOT NULL DEFAULT '',
+  request_time timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  net_amount bigint NOT NULL DEFAULT 0,
+  cpu_amount bigint NOT NULL DEFAULT 0,
+  CONSTRAINT idx_refunds_owner UNIQUE (owner)
+);
+
+CREATE TABLE IF NOT EXISTS stakes (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  account varchar(16) NOT NULL DEFAULT '',
+  cpu_amount_by_self bigint NOT NULL DEFAULT 0,
+  net_amount_by_self bigint NOT NULL DEFAULT 0,
+  cpu_amount_by_other bigint NOT NULL DEFAULT 0,
+  net_amount_by_other bigint NOT NULL DEFAULT 0,
+  CONSTRAINT idx_stakes_account UNIQUE (account)
+);
+
+CREATE TABLE IF NOT EXISTS tokens (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  account varchar(16) NOT NULL DEFAULT '',
+  symbol varchar(16) NOT NULL DEFAULT '',
+  balance bigint NOT NULL DEFAULT 0,
+  symbol_precision integer NOT NULL DEFAULT 0,
+  contract_owner varchar(16) NOT NULL DEFAULT '',
+  CONSTRAINT idx_symbol_owner_account UNIQUE (account, symbol, contract_owner)
+);
+CREATE INDEX IF NOT EXISTS idx_tokens_contract_symbol_balance ON tokens (contract_owner, symbol, balance);
+
+CREATE TABLE IF NOT EXISTS account_tokens (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  account varchar(16) NOT NULL DEFAULT '',
+  contract varchar(16) NOT NULL DEFAULT '',
+  CONSTRAINT idx_account_contract_tokens UNIQUE (account, contract)
+);
+
+CREATE TABLE IF NOT EXISTS votes (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  voter varchar(16) NOT NULL DEFAULT '',
+  proxy varchar(16) NOT NULL DEFAULT '',
+  producers text DEFAULT NULL,
+  CONSTRAINT idx_votes_voter UNIQUE (voter)
+);
+
+CREATE TABLE IF NOT EXISTS proposal (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  proposer varchar(16) NOT NULL DEFAULT '0',
+  proposal_name varchar(16) NOT NULL DEFAULT '0',
+  requested_approvals text NOT NULL,
+  CONSTRAINT idx_proposer_proposal_name UNIQUE (proposer, proposal_name)
+);
+
+CREATE TABLE IF NOT EXISTS action_stats_hourly (
+  contract varchar(16) NOT NULL DEFAULT '',
+  action varchar(16) NOT NULL DEFAULT '',
+  hour timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  actions bigint NOT NULL DEFAULT 0,
+  PRIMARY KEY (contract, action, hour)
+);
+CREATE INDEX IF NOT EXISTS idx_action_stats_hour ON action_stats_hourly (hour);
+
+CREATE TABLE IF NOT EXISTS producer_stats_hourly (
+  producer varchar(16) NOT NULL DEFAULT '',
+  hour timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  blocks bigint NOT NULL DEFAULT 0,
+  transactions bigint NOT NULL DEFAULT 0,
+  PRIMARY KEY (producer, hour)
+);
+CREATE INDEX IF NOT EXISTS idx_producer_stats_hour ON producer_stats_hourly (hour);
+
+CREATE TABLE IF NOT EXISTS transfer_stats_hourly (
+  contract varchar(16) NOT NULL DEFAULT '',
+  symbol varchar(16) NOT NULL DEFAULT '',
+  hour timestamp NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  transfers bigint NOT NULL DEFAULT 0,
+  volume bigint NOT NULL DEFAULT 0,
+  symbol_precision integer NOT NULL DEFAULT 0,
+  PRIMARY KEY (contract, symbol, hour)
+);
+CREATE INDEX IF NOT EXISTS idx_transfer_stats_hour ON transfer_stats_hourly (hour);
+
+CREATE TABLE IF NOT EXISTS producer_tally (
+  producer varchar(16) NOT NULL DEFAULT '',
+  voters bigint NOT NULL DEFAULT 0,
+  staked bigint NOT NULL DEFAULT 0,
+  PRIMARY KEY (producer)
+);
+CREATE INDEX IF NOT EXISTS idx_producer_tally_voters ON producer_tally (voters);
+CREATE INDEX IF NOT EXISTS idx_producer_tally_staked ON producer_tally (staked);
+
+CREATE TABLE IF NOT EXISTS voter_stakes (
+  voter varchar(16) NOT NULL DEFAULT '',
+  staked bigint DEFAULT NULL,
+  producers text DEFAULT NULL,
+  PRIMARY KEY (voter)
+);
+
+CREATE TABLE IF NOT EXISTS apply_status (
+  name varchar(32) NOT NULL DEFAULT '',
+  global_sequence bigint NOT NULL DEFAULT 0,
+  PRIMARY KEY (name)
+);
@@ -61,4 +61,145 @@ CREATE TABLE `traces` (
   PRIMARY KEY (`tx_id`),
   UNIQUE KEY `idx_transactions_id` (`id`)
 ) ENGINE=InnoDB AUTO_INCREMENT=80164 DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_general_ci;
-/*!40101 SET character_set_client = @saved_cs_client */;
\ No newline at end of file
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+CREATE TABLE IF NOT EXISTS `account_tokens` (
+  `id` bigint(20) NOT NULL AUTO_INCREMENT,
+  `account` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `contract` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `idx_account_contract` (`account`,`contract`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+ALTER TABLE `tokens` ADD KEY `idx_tokens_contract_symbol_balance` (`contract_owner`,`symbol`,`balance`);
+
+ALTER TABLE `actions` ADD COLUMN `global_sequence` bigint(20) NOT NULL DEFAULT '0', ADD COLUMN `block_num` int(11) NOT NULL DEFAULT '0', ADD KEY `idx_actions_global_sequence` (`global_sequence`);
+
+CREATE TABLE IF NOT EXISTS `account_actions` (
+  `account` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `action_seq` bigint(20) NOT NULL DEFAULT '0',
+  `contract` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `name` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `block_num` int(11) NOT NULL DEFAULT '0',
+  `created_at` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  PRIMARY KEY (`account`,`action_seq`),
+  KEY `idx_account_contract_name` (`account`,`contract`,`name`),
+  KEY `idx_account_contract` (`account`,`contract`),
+  KEY `idx_account_block` (`account`,`block_num`),
+  KEY `idx_account_created` (`account`,`created_at`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+CREATE TABLE IF NOT EXISTS `sync_status` (
+  `id` tinyint(4) NOT NULL DEFAULT '1',
+  `block_num` int(11) NOT NULL DEFAULT '0',
+  `updated_at` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  PRIMARY KEY (`id`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+CREATE TABLE IF NOT EXISTS `shards` (
+  `shard` smallint(6) NOT NULL,
+  `uri` varchar(512) NOT NULL DEFAULT '',
+  PRIMARY KEY (`shard`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+DELETE k1 FROM `accounts_keys` k1 JOIN `accounts_keys` k2
+  ON k1.`public_key` = k2.`public_key` AND k1.`account` = k2.`account` AND k1.`permission` = k2.`permission` AND k1.`id` > k2.`id`;
+ALTER TABLE `accounts_keys` DROP KEY `account`,
+  ADD UNIQUE KEY `idx_accounts_keys_key` (`public_key`,`account`,`permission`),
+  ADD KEY `idx_accounts_keys_account_permission` (`account`,`permission`);
+
+CREATE TABLE IF NOT EXISTS `action_stats_hourly` (
+  `contract` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `action` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `hour` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  `actions` bigint(20) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`contract`,`action`,`hour`),
+  KEY `idx_action_stats_hour` (`hour`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+CREATE TABLE IF NOT EXISTS `producer_stats_hourly` (
+  `producer` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `hour` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  `blocks` bigint(20) NOT NULL DEFAULT '0',
+  `transactions` bigint(20) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`producer`,`hour`),
+  KEY `idx_producer_stats_hour` (`hour`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+CREATE TABLE IF NOT EXISTS `transfer_stats_hourly` (
+  `contract` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `symbol` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `hour` datetime NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  `transfers` bigint(20) NOT NULL DEFAULT '0',
+  `volume` bigint(20) NOT NULL DEFAULT '0',
+  `symbol_precision` int(11) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`contract`,`symbol`,`hour`),
+  KEY `idx_transfer_stats_hour` (`hour`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+CREATE TABLE IF NOT EXISTS `producer_tally` (
+  `producer` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `voters` bigint(20) NOT NULL DEFAULT '0',
+  `staked` bigint(20) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`producer`),
+  KEY `idx_producer_tally_voters` (`voters`),
+  KEY `idx_producer_tally_staked` (`staked`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+CREATE TABLE IF NOT EXISTS `voter_stakes` (
+  `voter` varchar(16) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `staked` bigint(20) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`voter`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+-- voter counts of the votes already stored, staked weight starts from zero. JSON_TABLE needs MySQL 8;
+-- on MySQL 5.7 run the statement commented out below instead, which reads the first 30 entries of
+-- each list by index, as many producers as a vote may name
+INSERT INTO `producer_tally` (`producer`, `voters`)
+  SELECT p.`producer`, COUNT(*) FROM `votes`,
+    JSON_TABLE(`votes`.`producers`, '$[*]' COLUMNS (`producer` varchar(16) PATH '$')) p
+  GROUP BY p.`producer`
+  ON DUPLICATE KEY UPDATE `voters` = VALUES(`voters`);
+-- INSERT INTO `producer_tally` (`producer`, `voters`)
+--   SELECT JSON_UNQUOTE(JSON_EXTRACT(v.`producers`, CONCAT('$[', n.`i`, ']'))) AS `producer`, COUNT(*) FROM `votes` v
+--     JOIN (SELECT t.`d` * 10 + u.`d` AS `i` FROM
+--            (SELECT 0 AS `d` UNION ALL SELECT 1 UNION ALL SELECT 2) t,
+--            (SELECT 0 AS `d` UNION ALL SELECT 1 UNION ALL SELECT 2 UNION ALL SELECT 3 UNION ALL SELECT 4
+--             UNION ALL SELECT 5 UNION ALL SELECT 6 UNION ALL SELECT 7 UNION ALL SELECT 8 UNION ALL SELECT 9) u) n
+--       ON n.`i` < JSON_LENGTH(v.`producers`)
+--   GROUP BY `producer`
+--   ON DUPLICATE KEY UPDATE `voters` = VALUES(`voters`);
+
+-- actions are keyed by global sequence. Rows written before global_sequence was stored all have 0, they
+-- move unchanged to actions_legacy, which nothing writes to; re-sync those blocks to get them keyed again.
+-- Of the other rows only the copies left by replayed ranges are dropped, then the auto increment id.
+CREATE TABLE IF NOT EXISTS `actions_legacy` LIKE `actions`;
+INSERT INTO `actions_legacy` SELECT * FROM `actions` WHERE `global_sequence` = 0;
+DELETE FROM `actions` WHERE `global_sequence` = 0;
+DELETE a1 FROM `actions` a1 JOIN `actions` a2 ON a1.`global_sequence` = a2.`global_sequence` AND a1.`id` > a2.`id`;
+ALTER TABLE `actions` DROP COLUMN `id`, DROP KEY `idx_actions_global_sequence`, ADD PRIMARY KEY (`global_sequence`);
+
+-- seq is an ordinal in the transaction's action tree, which can outgrow smallint; parent is now the
+-- sender's seq rather than its global sequence
+ALTER TABLE `actions` MODIFY `seq` int(11) NOT NULL DEFAULT '0';
+
+-- the last global sequence the increment tables (rollups, producer_tally, tokens) committed; without a
+-- row a table starts from zero, as it did before
+CREATE TABLE IF NOT EXISTS `apply_status` (
+  `name` varchar(32) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `global_sequence` bigint(20) NOT NULL DEFAULT '0',
+  PRIMARY KEY (`name`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
+-- voter_stakes keeps each voter's producers too, written with producer_tally, so a voter the tally no
+-- longer caches is reloaded from what it counted; seeded from the votes already stored. The stake of a
+-- seeded voter is unknown, NULL: it counts as a voter, adds no weight and its stake changes are skipped
+ALTER TABLE `voter_stakes` ADD COLUMN `producers` json DEFAULT NULL, MODIFY `staked` bigint(20) DEFAULT NULL;
+INSERT INTO `voter_stakes` (`voter`, `staked`, `producers`)
+  SELECT `voter`, NULL, `producers` FROM `votes`
+  ON DUPLICATE KEY UPDATE `producers` = VALUES(`producers`);
+
+-- account_tokens only learns holders from transfers seen since it was created; seed it with every
+-- account that already has a tokens row
+INSERT IGNORE INTO `account_tokens` (`account`, `contract`)
+  SELECT DISTINCT `account`, `contract_owner` FROM `tokens`;
@@ -4,6 +4,7 @@
  */
 #include <eosio/sql_db_api_plugin/sql_db_api_plugin.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
 
 #include <fc/io/json.hpp>
 
@@ -22,6 +23,8 @@ void sql_db_api_plugin::plugin_initialize(const variables_map&) {}
 #define CALL(api_name, api_handle, api_namespace, call_name) \
 {std::string("/v1/" #api_name "/" #call_name), \
    [this, api_handle](string, string body, url_response_callback cb) mutable { \
+          static auto& latency = metrics::instance().endpoint(#call_name); \
+          metrics::scoped_timer t(latency); \
           try { \
              if (body.empty()) body = "{}"; \
              auto result = api_handle.call_name(fc::json::from_string(body).as<api_namespace::call_name ## _params>()); \
@@ -31,21 +34,92 @@ void sql_db_api_plugin::plugin_initialize(const variables_map&) {}
           } \
        }}
 
+#define CACHED_CALL(api_name, api_handle, api_namespace, call_name) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [this, api_handle](string, string body, url_response_callback cb) mutable { \
+          static auto& latency = metrics::instance().endpoint(#call_name); \
+          metrics::scoped_timer t(latency); \
+          try { \
+             if (body.empty()) body = "{}"; \
+             auto params = fc::json::from_string(body).as<api_namespace::call_name ## _params>(); \
+             cb(200, api_handle.cached_call(#call_name, params, [&](const api_namespace::call_name ## _params& p) { \
+                return api_handle.call_name(p); \
+             })); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+          } \
+       }}
+
+#define ASYNC_CALL(api_name, api_handle, api_namespace, call_name) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [this, api_handle](string, string body, url_response_callback cb) mutable { \
+          static auto& latency = metrics::instance().endpoint(#call_name); \
+          auto start = fc::time_point::now(); \
+          try { \
+             if (body.empty()) body = "{}"; \
+             auto params = fc::json::from_string(body).as<api_namespace::call_name ## _params>(); \
+             api_handle.async_call(params, \
+                [api_handle](const api_namespace::call_name ## _params& p) { \
+                   return api_handle.call_name ## _query(p); \
+                }, \
+                [api_handle](const api_namespace::call_name ## _params& p, const auto& rows) { \
+                   return fc::json::to_string(api_handle.call_name(p, rows)); \
+                }, \
+                [body, cb, start](std::exception_ptr e, const string& result) { \
+                   latency.observe( (fc::time_point::now() - start).count() ); \
+                   if (!e) { \
+                      cb(200, result); \
+                      return; \
+                   } \
+                   try { \
+                      std::rethrow_exception(e); \
+                   } catch (...) { \
+                      http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+                   } \
+                }); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+          } \
+       }}
+
 #define CHAIN_RO_CALL(call_name) CALL(sql_db, ro_api, sql_db_apis::read_only, call_name)
+#define CHAIN_RO_CACHED_CALL(call_name) CACHED_CALL(sql_db, ro_api, sql_db_apis::read_only, call_name)
+#define CHAIN_RO_ASYNC_CALL(call_name) ASYNC_CALL(sql_db, ro_api, sql_db_apis::read_only, call_name)
 
 void sql_db_api_plugin::plugin_startup() {
    ilog( "starting sql_db_api_plugin" );
    auto ro_api = app().get_plugin<sql_db_plugin>().get_read_only_api();
 
    app().get_plugin<http_plugin>().add_api({
-       CHAIN_RO_CALL(get_tokens),
+       {std::string("/v1/sql_db/get_metrics"),
+          [](string, string body, url_response_callback cb) {
+             try {
+                cb(200, fc::json::to_string(metrics::instance().to_variant()));
+             } catch (...) {
+                http_plugin::handle_exception("sql_db", "get_metrics", body, cb);
+             }
+          }},
+       // prometheus text exposition format
+       {std::string("/v1/sql_db/metrics"),
+          [](string, string body, url_response_callback cb) {
+             try {
+                cb(200, metrics::instance().to_prometheus());
+             } catch (...) {
+                http_plugin::handle_exception("sql_db", "metrics", body, cb);
+             }
+          }},
+       CHAIN_RO_CACHED_CALL(get_tokens),
+       CHAIN_RO_CALL(get_tokens_batch),
        CHAIN_RO_CALL(get_all_tokens),
-       CHAIN_RO_CALL(get_hold_tokens),
-       CHAIN_RO_CALL(get_userresource),
-       CHAIN_RO_CALL(get_refund),
+       CHAIN_RO_ASYNC_CALL(get_hold_tokens),
+       CHAIN_RO_ASYNC_CALL(get_account_actions),
+       CHAIN_RO_CACHED_CALL(get_userresource),
+       CHAIN_RO_CALL(get_userresource_batch),
+       CHAIN_RO_CACHED_CALL(get_refund),
        CHAIN_RO_CALL(get_pending_proposals),
        CHAIN_RO_CALL(get_pending_proposal),
-       CHAIN_RO_CALL(get_my_proposals)
+       CHAIN_RO_CALL(get_my_proposals),
+       CHAIN_RO_ASYNC_CALL(get_key_accounts)
    });
 }
 
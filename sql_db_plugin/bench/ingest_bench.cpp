@@ -0,0 +1,572 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Pushes synthetic transaction traces through consumer and sql_database into a local database
+ *  and reports ingest throughput. Point it at an empty schema created from eos.sql:
+ *
+ *    sql_db_ingest_bench --uri "mysql://db=eos_bench user=root host=127.0.0.1" --traces 200000 \
+ *        --mix transfer=70,voteproducer=10,newaccount=5,play=15 --inline-depth 2
+ *
+ *  or replays traces captured with sql_db-capture-file (or with --capture here), as fast as the
+ *  writer takes them or spaced out by their block times:
+ *
+ *    sql_db_ingest_bench --uri ... --replay mainnet.traces --pace recorded --speed 10 \
+ *        --action-filter-on transfer,voteproducer,newaccount,setabi
+ *
+ *  With --verify-decoders nothing is written: every action is decoded by the typed decoders and the
+ *  streaming json writer and compared with what abi_serializer gives, e.g. against a mainnet capture:
+ *
+ *    sql_db_ingest_bench --verify-decoders --replay mainnet.traces
+ */
+#include "consumer.hpp"
+
+#include <eosio/sql_db_plugin/metrics.hpp>
+#include <eosio/sql_db_plugin/trace_file.hpp>
+#include <eosio/sql_db_plugin/typed_decoders.hpp>
+#include <eosio/sql_db_plugin/abi_json_writer.hpp>
+#include <eosio/chain/eosio_contract.hpp>
+
+#include <fc/crypto/private_key.hpp>
+#include <fc/log/logger_config.hpp>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+namespace eosio { namespace bench {
+
+using namespace chain;
+
+struct voteproducer {
+    account_name            voter;
+    account_name            proxy;
+    vector<account_name>    producers;
+};
+
+struct token_create {
+    account_name    issuer;
+    asset           maximum_supply;
+};
+
+// stands in for a game contract action with its own abi
+struct play {
+    account_name    player;
+    uint64_t        seed;
+    string          memo;
+};
+
+} } // namespace
+
+FC_REFLECT( eosio::bench::token_create, (issuer)(maximum_supply) )
+FC_REFLECT( eosio::bench::voteproducer, (voter)(proxy)(producers) )
+FC_REFLECT( eosio::bench::play, (player)(seed)(memo) )
+
+namespace eosio { namespace bench {
+
+namespace bpo = boost::program_options;
+
+const account_name game_account = N(benchgame);
+
+// deterministic, valid account names: prefix followed by base-26 letters
+name make_name( const string& prefix, uint32_t i ) {
+    string s = prefix;
+    for( int d = 0; d < 12 - int(prefix.size()); ++d ){
+        s += char('a' + i % 26);
+        i /= 26;
+    }
+    return name(s);
+}
+
+string make_symbol( uint32_t i ) {
+    string s = "T";
+    for( int d = 0; d < 4; ++d ){
+        s += char('A' + i % 26);
+        i /= 26;
+    }
+    return s;
+}
+
+abi_def token_abi() {
+    abi_def abi;
+    abi.version = "eosio::abi/1.0";
+    abi.types.push_back( type_def{"account_name", "name"} );
+    abi.structs.push_back( struct_def{"transfer", "", {{"from", "account_name"}, {"to", "account_name"}, {"quantity", "asset"}, {"memo", "string"}}} );
+    abi.structs.push_back( struct_def{"issue", "", {{"to", "account_name"}, {"quantity", "asset"}, {"memo", "string"}}} );
+    abi.structs.push_back( struct_def{"create", "", {{"issuer", "account_name"}, {"maximum_supply", "asset"}}} );
+    abi.structs.push_back( struct_def{"account", "", {{"balance", "asset"}}} );
+    abi.actions.push_back( action_def{N(transfer), "transfer", ""} );
+    abi.actions.push_back( action_def{N(issue), "issue", ""} );
+    abi.actions.push_back( action_def{N(create), "create", ""} );
+    abi.tables.push_back( table_def{N(accounts), "i64", {}, {}, "account"} );
+    return abi;
+}
+
+abi_def system_abi() {
+    abi_def abi = eosio_contract_abi( abi_def() );
+    abi.structs.push_back( struct_def{"voteproducer", "", {{"voter", "account_name"}, {"proxy", "account_name"}, {"producers", "account_name[]"}}} );
+    abi.actions.push_back( action_def{N(voteproducer), "voteproducer", ""} );
+    return abi;
+}
+
+abi_def game_abi() {
+    abi_def abi;
+    abi.version = "eosio::abi/1.0";
+    abi.structs.push_back( struct_def{"play", "", {{"player", "name"}, {"seed", "uint64"}, {"memo", "string"}}} );
+    abi.actions.push_back( action_def{N(play), "play", ""} );
+    return abi;
+}
+
+struct bench_options {
+    uint32_t                    traces = 100000;
+    uint32_t                    actions_per_trace = 1;
+    uint32_t                    inline_depth = 1;
+    uint32_t                    trxs_per_block = 100;
+    uint32_t                    contracts = 10;
+    uint32_t                    accounts = 10000;
+    uint32_t                    producers = 30;
+    std::vector<std::pair<name, uint32_t>> mix;
+    uint64_t                    seed = 1;
+};
+
+/**
+ * Builds transaction traces shaped like the ones applied_transaction delivers: every action trace
+ * carries its notification traces, and transfers can forward inline transfers down to inline_depth.
+ */
+class trace_generator {
+    public:
+        explicit trace_generator( const bench_options& o ) : m_options(o), m_rng(o.seed) {
+            for( const auto& m : o.mix ) m_mix_total += m.second;
+            for( uint32_t i = 0; i < 16; ++i ){
+                auto key = fc::crypto::private_key::regenerate<fc::ecc::private_key_shim>( fc::sha256::hash( std::to_string(i) ) );
+                m_keys.push_back( key.get_public_key() );
+            }
+        }
+
+        // abis and token creates the workload depends on
+        vector<transaction_trace_ptr> setup() {
+            vector<transaction_trace_ptr> traces;
+            traces.push_back( make_trx( { notified( make_action( config::system_account_name, N(setabi), setabi{ config::system_account_name, fc::raw::pack(system_abi()) } ), {} ) } ) );
+            traces.push_back( make_trx( { notified( make_action( config::system_account_name, N(setabi), setabi{ game_account, fc::raw::pack(game_abi()) } ), {} ) } ) );
+            for( uint32_t i = 0; i < m_options.contracts; ++i ){
+                const auto contract = make_name( "benchtoken", i );
+                traces.push_back( make_trx( { notified( make_action( config::system_account_name, N(setabi), setabi{ contract, fc::raw::pack(token_abi()) } ), {} ) } ) );
+                token_create create{ contract, asset( 1000000000000ll, symbol(4, make_symbol(i).c_str()) ) };
+                traces.push_back( make_trx( { notified( make_action( contract, N(create), create ), {} ) } ) );
+            }
+            return traces;
+        }
+
+        transaction_trace_ptr next() {
+            vector<action_trace> actions;
+            for( uint32_t i = 0; i < m_options.actions_per_trace; ++i ){
+                actions.push_back( next_action() );
+            }
+            return make_trx( std::move(actions) );
+        }
+
+        vector<string> action_names() const {
+            vector<string> names = { "setabi", "create" };
+            for( const auto& m : m_options.mix ) names.push_back( m.first.to_string() );
+            return names;
+        }
+
+    private:
+        action_trace next_action() {
+            uint32_t pick = m_rng() % m_mix_total;
+            name kind;
+            for( const auto& m : m_options.mix ){
+                if( pick < m.second ){ kind = m.first; break; }
+                pick -= m.second;
+            }
+
+            if( kind == N(transfer) ){
+                return transfer( random_account(), random_account(), m_options.inline_depth );
+            } else if( kind == N(voteproducer) ){
+                voteproducer v;
+                v.voter = random_account();
+                std::set<account_name> producers;
+                const auto count = 1 + m_rng() % m_options.producers;
+                while( producers.size() < count ) producers.insert( make_name( "benchprod", m_rng() % m_options.producers ) );
+                v.producers.assign( producers.begin(), producers.end() );
+                return notified( make_action( config::system_account_name, N(voteproducer), v ), {} );
+            } else if( kind == N(newaccount) ){
+                newaccount n;
+                n.creator = random_account();
+                n.name = make_name( "benchnew", m_new_accounts++ );
+                n.owner = authority( m_keys[ m_rng() % m_keys.size() ] );
+                n.active = authority( m_keys[ m_rng() % m_keys.size() ] );
+                return notified( make_action( config::system_account_name, N(newaccount), n ), {} );
+            } else {
+                play g{ random_account(), m_rng(), "bench" };
+                return notified( make_action( game_account, N(play), g ), { g.player } );
+            }
+        }
+
+        action_trace transfer( const account_name& from, const account_name& to, uint32_t depth ) {
+            const auto i = m_rng() % m_options.contracts;
+            const auto contract = make_name( "benchtoken", i );
+            token_transfer t{ from, to, asset( 1 + m_rng() % 100000, symbol(4, make_symbol(i).c_str()) ), "bench" };
+            auto trace = notified( make_action( contract, N(transfer), t ), { from, to } );
+            if( depth > 1 ){
+                trace.inline_traces.push_back( transfer( to, random_account(), depth - 1 ) );
+            }
+            return trace;
+        }
+
+        template<typename T>
+        action make_action( const account_name& contract, const action_name& act_name, const T& data ) {
+            action act;
+            act.account = contract;
+            act.name = act_name;
+            act.authorization = { permission_level{ contract, config::active_name } };
+            act.data = fc::raw::pack( data );
+            return act;
+        }
+
+        action_trace notified( const action& act, const vector<account_name>& notify ) {
+            action_trace trace;
+            trace.act = act;
+            trace.receipt.receiver = act.account;
+            trace.receipt.global_sequence = ++m_global_sequence;
+            for( const auto& n : notify ){
+                if( n == act.account ) continue;
+                action_trace note;
+                note.act = act;
+                note.receipt.receiver = n;
+                note.receipt.global_sequence = ++m_global_sequence;
+                trace.inline_traces.push_back( std::move(note) );
+            }
+            return trace;
+        }
+
+        transaction_trace_ptr make_trx( vector<action_trace> actions ) {
+            auto trace = std::make_shared<transaction_trace>();
+            trace->id = fc::sha256::hash( std::to_string( ++m_trx_count ) );
+            if( ++m_in_block > m_options.trxs_per_block ){
+                m_in_block = 1;
+                ++m_block_num;
+            }
+            trace->block_num = m_block_num;
+            trace->block_time = block_timestamp_type( m_block_num );
+            trace->action_traces = std::move(actions);
+            return trace;
+        }
+
+        account_name random_account() {
+            return make_name( "benchuser", m_rng() % m_options.accounts );
+        }
+
+        const bench_options& m_options;
+        std::mt19937_64 m_rng;
+        uint32_t m_mix_total = 0;
+        vector<public_key_type> m_keys;
+        uint64_t m_global_sequence = 0;
+        uint64_t m_trx_count = 0;
+        uint32_t m_block_num = 1;
+        uint32_t m_in_block = 0;
+        uint32_t m_new_accounts = 0;
+};
+
+uint64_t rows_written() {
+    uint64_t total = 0;
+    for( const auto& r : metrics::instance().to_variant()["rows"].get_object() ){
+        total += r.value()["total"].as_uint64();
+    }
+    return total;
+}
+
+/**
+ * Feeds a capture file to the consumer in file order. With recorded pacing a trace is not pushed
+ * before its block time, relative to the first trace and divided by speed, has passed.
+ */
+class replay_driver {
+    public:
+        replay_driver( const string& path, bool recorded, double speed )
+            : m_reader(path), m_recorded(recorded), m_speed(speed) {}
+
+        size_t count() const { return m_reader.count(); }
+
+        template<typename F>
+        void run( F&& push ) {
+            trace_file::record r;
+            fc::time_point first_block, start;
+            for( uint64_t offset = m_reader.first(); m_reader.read( offset, r ); offset = trace_file_reader::next( offset, r ) ){
+                if( m_recorded ){
+                    if( offset == m_reader.first() ){
+                        first_block = r.block_time;
+                        start = fc::time_point::now();
+                    }
+                    const auto due = start + fc::microseconds( int64_t( (r.block_time - first_block).count() / m_speed ) );
+                    const auto wait = due - fc::time_point::now();
+                    if( wait.count() > 0 ) boost::this_thread::sleep_for( boost::chrono::microseconds( wait.count() ) );
+                }
+                push( r.unpack() );
+            }
+        }
+
+    private:
+        trace_file_reader m_reader;
+        bool m_recorded;
+        double m_speed;
+};
+
+/**
+ * Differential check of the typed decoders and abi_json_writer against abi_serializer. The abis come
+ * from the setabi actions seen so far (and the built-in one for eosio); every action of a contract
+ * with an abi is written by the json writer, and by its typed decoder when the abi matches, and the
+ * data json and account fields compared.
+ */
+class decoder_check {
+    public:
+        decoder_check() {
+            m_abis[ config::system_account_name ] = serializer( eosio_contract_abi(abi_def()) );
+        }
+
+        void add( const transaction_trace_ptr& trace ) {
+            for( const auto& at : trace->action_traces ) visit( at );
+        }
+
+        int report() const {
+            std::cout << "typed checked:     " << m_typed.checked << ", mismatched " << m_typed.mismatched << "\n"
+                      << "typed abi differs: " << m_not_matching << " (left to the json writer)\n"
+                      << "writer checked:    " << m_writer.checked << ", mismatched " << m_writer.mismatched << std::endl;
+            return m_typed.mismatched == 0 && m_writer.mismatched == 0 ? 0 : 1;
+        }
+
+    private:
+        struct tally {
+            uint64_t checked = 0;
+            uint64_t mismatched = 0;
+        };
+
+        static std::shared_ptr<abi_serializer> serializer( const abi_def& abi ) {
+            auto abis = std::make_shared<abi_serializer>();
+            abis->set_abi( abi, fc::microseconds(150*1000) );
+            return abis;
+        }
+
+        static bool same_args( const system_contract_arg& e, const system_contract_arg& a ) {
+            return e.to == a.to && e.from == a.from && e.receiver == a.receiver
+                && e.payer == a.payer && e.name == a.name && e.account == a.account;
+        }
+
+        void visit( const action_trace& at ) {
+            check( at.act );
+            for( const auto& i : at.inline_traces ) visit( i );
+        }
+
+        void check( const action& act ) {
+            if( act.account == config::system_account_name && act.name == setabi::get_name() ){
+                const auto s = act.data_as<setabi>();
+                m_abis[ s.account ] = serializer( fc::raw::unpack<abi_def>(s.abi) );
+                return;
+            }
+
+            auto itr = m_abis.find( act.account );
+            if( itr == m_abis.end() ) return;
+            const auto& abis = *itr->second;
+            const auto type = abis.get_action_type( act.name );
+            if( type.empty() ) return;
+
+            fc::optional<action_data> expected;
+            try{ expected = action_data( abis.binary_to_variant( type, act.data, fc::microseconds(150*1000) ) ); } catch(...) {}
+
+            fc::optional<action_data> written;
+            try{
+                system_contract_arg args;
+                const auto& json = m_writer_json.write( abis, type, act.data, &args );
+                written = action_data( json, args );
+            } catch(...) {}
+            compare( m_writer, "json writer", act, expected, written );
+
+            const auto* decoder = typed_decoder::find( act.name );
+            if( !decoder ) return;
+            if( !decoder->matches( abis, type ) ){
+                ++m_not_matching;
+                return;
+            }
+            fc::optional<action_data> typed;
+            try{ typed = decoder->decode( act.data ); } catch(...) {}
+            compare( m_typed, "typed", act, expected, typed );
+        }
+
+        void compare( tally& t, const char* what, const action& act, const fc::optional<action_data>& expected, const fc::optional<action_data>& actual ) {
+            ++t.checked;
+            bool same = bool(expected) == bool(actual);
+            if( same && expected ){
+                same = expected->json() == actual->json() && same_args( expected->args(), actual->args() );
+            }
+            if( !same && ++t.mismatched <= 10 ){
+                std::cerr << what << " " << act.account.to_string() << "::" << act.name.to_string() << "\n"
+                          << "  abi_serializer: " << ( expected ? expected->json() : "<failed>" ) << "\n"
+                          << "  " << what << ": " << ( actual ? actual->json() : "<failed>" ) << std::endl;
+            }
+        }
+
+        std::map<account_name, std::shared_ptr<abi_serializer>> m_abis;
+        abi_json_writer m_writer_json;
+        tally m_typed;
+        tally m_writer;
+        uint64_t m_not_matching = 0;
+};
+
+void drain() {
+    while( metrics::instance().trace_queue_depth.value() > 0 ){
+        boost::this_thread::sleep_for( boost::chrono::milliseconds(10) );
+    }
+}
+
+int run( int argc, char** argv ) {
+    bench_options o;
+    string uri;
+    string mix;
+    string filter;
+    string replay;
+    string pace;
+    string capture;
+    double speed = 1;
+    uint32_t queue_size = 5000;
+    bool verify_decoders = false;
+
+    bpo::options_description desc("sql_db_plugin ingest benchmark");
+    desc.add_options()
+        ("help,h", "Print this help")
+        ("uri", bpo::value<string>(&uri), "Sql DB URI of an empty database created from eos.sql")
+        ("traces", bpo::value<uint32_t>(&o.traces)->default_value(o.traces), "Number of transaction traces to push")
+        ("actions-per-trace", bpo::value<uint32_t>(&o.actions_per_trace)->default_value(o.actions_per_trace), "Top level actions per trace")
+        ("inline-depth", bpo::value<uint32_t>(&o.inline_depth)->default_value(o.inline_depth), "Depth of inline transfer chains")
+        ("trxs-per-block", bpo::value<uint32_t>(&o.trxs_per_block)->default_value(o.trxs_per_block), "Transactions per synthetic block")
+        ("contracts", bpo::value<uint32_t>(&o.contracts)->default_value(o.contracts), "Number of token contracts, each with the token abi")
+        ("accounts", bpo::value<uint32_t>(&o.accounts)->default_value(o.accounts), "Number of distinct user accounts")
+        ("mix", bpo::value<string>(&mix)->default_value("transfer=70,voteproducer=10,newaccount=5,play=15"),
+            "Action mix as name=weight, from transfer, voteproducer, newaccount and play")
+        ("queue-size", bpo::value<uint32_t>(&queue_size)->default_value(queue_size), "Consumer queue size")
+        ("seed", bpo::value<uint64_t>(&o.seed)->default_value(o.seed), "Random seed")
+        ("replay", bpo::value<string>(&replay), "Push the traces of this capture file instead of synthetic ones")
+        ("pace", bpo::value<string>(&pace)->default_value("full"), "Replay pacing: full (no waits) or recorded (by block time)")
+        ("speed", bpo::value<double>(&speed)->default_value(speed), "Speed-up of recorded pacing")
+        ("capture", bpo::value<string>(&capture), "Also write the pushed traces to this capture file")
+        ("action-filter-on", bpo::value<string>(&filter),
+            "Comma separated action names to store, as sql_db-action-filter-on; defaults to the synthetic mix")
+        ("verify-decoders", bpo::bool_switch(&verify_decoders), "Compare the typed decoders with abi_serializer on the traces instead of writing them")
+        ;
+
+    bpo::variables_map vm;
+    bpo::store( bpo::parse_command_line(argc, argv, desc), vm );
+    if( vm.count("help") ){
+        std::cout << desc << std::endl;
+        return 0;
+    }
+    bpo::notify( vm );
+
+    vector<string> parts;
+    boost::split( parts, mix, boost::is_any_of(",") );
+    for( const auto& part : parts ){
+        vector<string> kv;
+        boost::split( kv, part, boost::is_any_of("=") );
+        FC_ASSERT( kv.size() == 2, "invalid mix entry ${e}", ("e",part) );
+        o.mix.emplace_back( name(kv[0]), std::stoul(kv[1]) );
+    }
+    FC_ASSERT( !o.mix.empty() && o.contracts > 0 && o.accounts > 0 );
+    FC_ASSERT( pace == "full" || pace == "recorded", "pace is full or recorded" );
+    FC_ASSERT( speed > 0 );
+    FC_ASSERT( verify_decoders || !uri.empty(), "--uri is required" );
+
+    fc::logger::get(DEFAULT_LOGGER).set_log_level( fc::log_level::error );
+
+    trace_generator gen( o );
+
+    if( verify_decoders ){
+        decoder_check check;
+        if( !replay.empty() ){
+            replay_driver( replay, false, 1 ).run( [&]( const transaction_trace_ptr& t ){ check.add( t ); } );
+        } else {
+            for( const auto& t : gen.setup() ) check.add( t );
+            for( uint32_t i = 0; i < o.traces; ++i ) check.add( gen.next() );
+        }
+        return check.report();
+    }
+
+    vector<string> action_filter_on = gen.action_names();
+    if( !filter.empty() ) boost::split( action_filter_on, filter, boost::is_any_of(",") );
+
+    auto db = std::make_unique<sql_database>( uri, 0, 5, action_filter_on, vector<string>() );
+    db->m_proposal_index = std::make_shared<proposal_index>();
+    db->m_token_registry = std::make_shared<token_registry>();
+    db->m_actions_table->m_token_registry = db->m_token_registry;
+    db->m_holder_index = std::make_shared<holder_index>( 100000 );
+    if( !db->is_started() ) db->wipe();
+
+    std::unique_ptr<replay_driver> replayer;
+    if( !replay.empty() ){
+        replayer = std::make_unique<replay_driver>( replay, pace == "recorded", speed );
+        o.traces = replayer->count();
+    }
+
+    consumer c( std::move(db), queue_size, capture.empty() ? nullptr : std::make_unique<trace_file_writer>( capture ) );
+
+    // a capture carries its own setabi and create actions
+    if( !replayer ){
+        for( const auto& t : gen.setup() ) c.push_transaction_trace( t );
+        drain();
+    }
+
+    vector<uint64_t> enqueue_us;
+    enqueue_us.reserve( o.traces );
+    const auto rows_before = rows_written();
+    const auto start = fc::time_point::now();
+
+    auto push = [&]( const transaction_trace_ptr& trace ){
+        const auto t0 = fc::time_point::now();
+        c.push_transaction_trace( trace );
+        enqueue_us.push_back( (fc::time_point::now() - t0).count() );
+    };
+    if( replayer ){
+        replayer->run( push );
+    } else {
+        for( uint32_t i = 0; i < o.traces; ++i ) push( gen.next() );
+    }
+    drain();
+
+    // the writer flushes its last batch on the way out
+    c.shutdown();
+
+    const double seconds = (fc::time_point::now() - start).count() / 1e6;
+    const auto rows = rows_written() - rows_before;
+
+    std::sort( enqueue_us.begin(), enqueue_us.end() );
+    auto percentile = [&]( double p ){
+        return enqueue_us.empty() ? 0 : enqueue_us[ std::min<size_t>( enqueue_us.size() - 1, enqueue_us.size() * p ) ];
+    };
+
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+
+    std::cout << "traces:        " << o.traces << " in " << seconds << " s\n"
+              << "traces/sec:    " << o.traces / seconds << "\n"
+              << "rows/sec:      " << rows / seconds << " (" << rows << " rows)\n"
+              << "enqueue p50:   " << percentile(0.50) << " us\n"
+              << "enqueue p99:   " << percentile(0.99) << " us\n"
+              << "peak rss:      " << usage.ru_maxrss / 1024 << " MB\n"
+              << "metrics:       " << fc::json::to_pretty_string( metrics::instance().to_variant() ) << std::endl;
+    return 0;
+}
+
+} } // namespace
+
+int main( int argc, char** argv ) {
+    try {
+        return eosio::bench::run( argc, argv );
+    } catch( const fc::exception& e ) {
+        std::cerr << e.to_detail_string() << std::endl;
+    } catch( const std::exception& e ) {
+        std::cerr << e.what() << std::endl;
+    }
+    return 1;
+}
@@ -15,6 +15,9 @@
 #include <eosio/chain/transaction.hpp>
 #include <fc/log/logger.hpp>
 #include <eosio/sql_db_plugin/database.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+#include <eosio/sql_db_plugin/trace_file.hpp>
+#include <eosio/sql_db_plugin/spill_journal.hpp>
 
 // #include "database.hpp"
 
@@ -22,7 +25,11 @@ namespace eosio {
 
 class consumer final : public boost::noncopyable {
     public:
-        consumer(std::unique_ptr<sql_database> db, size_t queue_size);
+        // capture, if given, records every trace the writer consumes; with a spill journal traces that
+        // do not fit the queue go to disk instead of blocking the caller. A batch that fails to write
+        // flush_retries times is written a row at a time, see flush_batch
+        consumer(std::unique_ptr<sql_database> db, size_t queue_size, std::unique_ptr<trace_file_writer> capture = nullptr,
+                 std::unique_ptr<spill_journal> spill = nullptr, uint32_t flush_retries = 10);
         ~consumer();
         void shutdown();
 
@@ -34,6 +41,8 @@ class consumer final : public boost::noncopyable {
         void push_block_state( const chain::block_state_ptr& );
         void run_blocks();
         void run_traces();
+        void consume_trace( const chain::transaction_trace_ptr& );
+        void flush_batch();
 
         std::deque<chain::block_state_ptr> block_state_queue;
         std::deque<chain::block_state_ptr> block_state_process_queue;
@@ -44,37 +53,45 @@ class consumer final : public boost::noncopyable {
 
         std::unique_ptr<sql_database> db;
         size_t queue_size;
+        std::unique_ptr<trace_file_writer> capture;
+        std::unique_ptr<spill_journal> spill;
+        uint32_t flush_retries;
         boost::atomic<bool> exit{false};
-        boost::thread consume_thread_run_blocks;
         boost::mutex mtx_blocks;
-        boost::thread consume_thread_run_traces;
         boost::mutex mtx_traces;
         boost::condition_variable condition;
+        // last, so everything the threads use exists before they start
+        boost::thread consume_thread_run_blocks;
+        boost::thread consume_thread_run_traces;
 
     };
 
-    consumer::consumer(std::unique_ptr<sql_database> db, size_t queue_size):
+    inline consumer::consumer(std::unique_ptr<sql_database> db, size_t queue_size, std::unique_ptr<trace_file_writer> capture,
+                              std::unique_ptr<spill_journal> spill, uint32_t flush_retries):
         db(std::move(db)),
         queue_size(queue_size),
+        capture(std::move(capture)),
+        spill(std::move(spill)),
+        flush_retries(flush_retries),
         exit(false),
         consume_thread_run_blocks(boost::thread([&]{this->run_blocks();})),
         consume_thread_run_traces(boost::thread([&]{this->run_traces();}))
         { }
 
-    consumer::~consumer() {
-        exit = true;
-        condition.notify_all();
-        consume_thread_run_blocks.join();
+    inline consumer::~consumer() {
+        shutdown();
     }
 
-    void consumer::shutdown() {
+    // waits for the writer threads to write or spill what is queued
+    inline void consumer::shutdown() {
         exit = true;
         condition.notify_all();
-        consume_thread_run_blocks.join();
+        if( consume_thread_run_blocks.joinable() ) consume_thread_run_blocks.join();
+        if( consume_thread_run_traces.joinable() ) consume_thread_run_traces.join();
     }
 
     template<typename Queue, typename Entry>
-    void consumer::queue(boost::mutex& mtx, boost::condition_variable& condition, Queue& queue, const Entry& e, size_t queue_size) {
+    inline void consumer::queue(boost::mutex& mtx, boost::condition_variable& condition, Queue& queue, const Entry& e, size_t queue_size) {
         int sleep_time = 100;
         size_t last_queue_size = 0;
         boost::mutex::scoped_lock lock(mtx);
@@ -96,9 +113,31 @@ class consumer final : public boost::noncopyable {
         condition.notify_all();
     }
 
-    void consumer::push_block_state( const chain::block_state_ptr& bs ){
+    // rough in-memory footprint of a queued entry, for the queue bytes gauges
+    inline int64_t queued_bytes( const vector<chain::action_trace>& traces ){
+        int64_t bytes = 0;
+        for( const auto& atc : traces ){
+            bytes += sizeof(chain::action_trace) + atc.act.data.size() + queued_bytes( atc.inline_traces );
+        }
+        return bytes;
+    }
+
+    inline int64_t queued_bytes( const chain::transaction_trace_ptr& tt ){
+        return sizeof(chain::transaction_trace) + queued_bytes( tt->action_traces );
+    }
+
+    inline int64_t queued_bytes( const chain::block_state_ptr& bs ){
+        return sizeof(chain::block_state) + fc::raw::pack_size( *bs->block );
+    }
+
+    inline void consumer::push_block_state( const chain::block_state_ptr& bs ){
         try {
+            auto& m = metrics::instance();
+            auto start = fc::time_point::now();
             queue(mtx_blocks, condition, block_state_queue, bs, queue_size);
+            m.enqueue_wait.observe( (fc::time_point::now() - start).count() );
+            m.block_queue_depth.add( 1 );
+            m.block_queue_bytes.add( queued_bytes(bs) );
         } catch (fc::exception& e) {
             elog("FC Exception while accepted_block ${e}", ("e", e.to_string()));
         } catch (std::exception& e) {
@@ -108,9 +147,29 @@ class consumer final : public boost::noncopyable {
         }
     }
 
-    void consumer::push_transaction_trace( const chain::transaction_trace_ptr& tt){
+    inline void consumer::push_transaction_trace( const chain::transaction_trace_ptr& tt){
         try {
-            queue(mtx_traces, condition, transaction_trace_queue, tt, queue_size);
+            auto& m = metrics::instance();
+            auto start = fc::time_point::now();
+            if( spill ){
+                // once anything is spilled, later traces follow it to keep the order
+                boost::mutex::scoped_lock lock(mtx_traces);
+                if( transaction_trace_queue.size() >= queue_size || spill->unread() > 0 ){
+                    spill->append( *tt );
+                    lock.unlock();
+                    condition.notify_all();
+                    m.enqueue_wait.observe( (fc::time_point::now() - start).count() );
+                    return;
+                }
+                transaction_trace_queue.emplace_back(tt);
+                lock.unlock();
+                condition.notify_all();
+            } else {
+                queue(mtx_traces, condition, transaction_trace_queue, tt, queue_size);
+            }
+            m.enqueue_wait.observe( (fc::time_point::now() - start).count() );
+            m.trace_queue_depth.add( 1 );
+            m.trace_queue_bytes.add( queued_bytes(tt) );
         } catch (fc::exception& e) {
             elog("FC Exception while applied_transaction ${e}", ("e", e.to_string()));
         } catch (std::exception& e) {
@@ -120,7 +179,7 @@ class consumer final : public boost::noncopyable {
         }
     }
 
-    void consumer::run_blocks() {
+    inline void consumer::run_blocks() {
         ilog("Consumer thread Start run_blocks");
         while (!exit) { 
             try{
@@ -154,6 +213,8 @@ class consumer final : public boost::noncopyable {
                     } catch (...) {
                         elog("Unknown exception while consuming block");
                     } 
+                    metrics::instance().block_queue_depth.add( -1 );
+                    metrics::instance().block_queue_bytes.add( -queued_bytes(bs) );
                     block_state_process_queue.pop_front();
                 }
 
@@ -169,15 +230,76 @@ class consumer final : public boost::noncopyable {
         ilog("Consumer thread End run_blocks");
     }
 
-    void consumer::run_traces(){
+    inline void consumer::consume_trace( const chain::transaction_trace_ptr& tc ){
+        try{
+            // before consuming, so a trace the writer chokes on is in the capture
+            if( capture ) capture->append( *tc );
+            db->consume_transaction_trace( tc );
+        } catch (fc::exception& e) {
+            elog("FC Exception while consuming block ${e}", ("e", e.to_string()));
+        } catch (std::exception& e) {
+            elog("STD Exception while consuming block ${e}", ("e", e.what()));
+        } catch (...) {
+            elog("Unknown exception while consuming block");
+        }
+    }
+
+    // writes the consumed batch, retrying until the database takes it. From the flush_retries-th retry
+    // on, the tables that keep failing are written a row at a time: rows the database refuses on their
+    // own go to the dead letter file, so one bad value cannot stop the writer, while a database that
+    // does not answer is still waited for. The spill journal only moves past the batch once it is
+    // written, so traces of an abandoned batch that came from the journal are read again on restart.
+    inline void consumer::flush_batch() {
+        int sleep_time = 100;
+        for( uint32_t attempt = 0; ; ++attempt ){
+            if( attempt == flush_retries && flush_retries > 0 ){
+                wlog("batch failed ${n} times, writing the failing tables a row at a time", ("n", attempt));
+            }
+            try{
+                if( capture ) capture->flush();
+                if( db->flush( attempt >= flush_retries ) ){
+                    if( spill ) spill->commit();
+                    return;
+                }
+            } catch (fc::exception& e) {
+                elog("FC Exception while flushing batch ${e}", ("e", e.to_string()));
+            } catch (std::exception& e) {
+                elog("STD Exception while flushing batch ${e}", ("e", e.what()));
+            } catch (...) {
+                elog("Unknown exception while flushing batch");
+            }
+            if( exit ){
+                elog("batch not written on exit");
+                return;
+            }
+            wlog("flushing batch failed, retrying in ${t}ms", ("t", sleep_time));
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(sleep_time));
+            sleep_time = std::min( sleep_time * 2, 5000 );
+        }
+    }
+
+    // the queue is always older than the spill journal, so it is written first; on exit the queue
+    // goes to the journal when that keeps the order, otherwise to the database
+    inline void consumer::run_traces(){
         ilog("Consumer thread Start run_traces");
-        while (!exit) { 
+        while (true) {
             try{
                 boost::mutex::scoped_lock lock(mtx_traces);
-                while(transaction_trace_queue.empty() && !exit){
+                while(transaction_trace_queue.empty() && !exit && !(spill && spill->unread() > 0)){
                     condition.wait(lock);
                 }
 
+                if( exit && spill && spill->unread() == 0 ){
+                    ilog("spilling queue on exit, size: ${q}", ("q", transaction_trace_queue.size()));
+                    for( const auto& tc : transaction_trace_queue ){
+                        spill->append( *tc );
+                        metrics::instance().trace_queue_depth.add( -1 );
+                        metrics::instance().trace_queue_bytes.add( -queued_bytes(tc) );
+                    }
+                    transaction_trace_queue.clear();
+                }
+                if( exit && transaction_trace_queue.empty() ) break;
+
                 size_t transaction_trace_size = transaction_trace_queue.size();
                 if( transaction_trace_size > 0 ){
                     transaction_trace_process_queue = std::move(transaction_trace_queue);
@@ -191,21 +313,23 @@ class consumer final : public boost::noncopyable {
                     ilog("reversible draining queue, size: ${q}", ("q", transaction_trace_size));
                 }          
 
+                if( transaction_trace_process_queue.empty() && spill ){
+                    for( const auto& tc : spill->read( queue_size ) ){
+                        consume_trace( tc );
+                    }
+                }
+
                 // process blocks
                 while (!transaction_trace_process_queue.empty()) {
                     const auto& tc = transaction_trace_process_queue.front();
-                    try{
-                        db->consume_transaction_trace( tc );
-                    } catch (fc::exception& e) {
-                        elog("FC Exception while consuming block ${e}", ("e", e.to_string()));
-                    } catch (std::exception& e) {
-                        elog("STD Exception while consuming block ${e}", ("e", e.what()));
-                    } catch (...) {
-                        elog("Unknown exception while consuming block");
-                    } 
+                    consume_trace( tc );
+                    metrics::instance().trace_queue_depth.add( -1 );
+                    metrics::instance().trace_queue_bytes.add( -queued_bytes(tc) );
                     transaction_trace_process_queue.pop_front();
                 }
 
+                flush_batch();
+
                 condition.notify_all();
             } catch (std::exception& e) {
                 elog("lose some catch ${e}", ("e", e.what()));
@@ -214,6 +338,17 @@ class consumer final : public boost::noncopyable {
             }  
 
         }
+
+        try{
+            if( capture ) capture->flush();
+        } catch (...) {
+            elog("Unknown exception while flushing capture");
+        }
+        try{
+            db->drain_shards();
+        } catch (std::exception& e) {
+            elog("STD Exception while draining shards ${e}", ("e", e.what()));
+        }
         
         ilog("Consumer thread End run_traces");
     }
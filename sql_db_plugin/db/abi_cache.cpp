@@ -0,0 +1,78 @@
+// #include "abi_cache.hpp"
+#include <eosio/sql_db_plugin/abi_cache.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+#include <eosio/sql_db_plugin/typed_decoders.hpp>
+
+#include <eosio/chain/eosio_contract.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+
+namespace eosio {
+
+    bool abi_cache::entry::typed_match( chain::action_name action, const typed_decoder& decoder ) {
+        auto itr = typed.find( action.value );
+        if( itr == typed.end() ){
+            const auto type = serializer.get_action_type( action );
+            itr = typed.emplace( action.value, !type.empty() && decoder.matches( serializer, type ) ).first;
+        }
+        return itr->second;
+    }
+
+    std::shared_ptr<abi_cache::entry> abi_cache::get( soci::session& sql, chain::account_name contract ) {
+        auto cached = m_entries.get( contract.value );
+        if( cached ){
+            metrics::instance().abi_cache_hits.add();
+            return *cached;
+        }
+        metrics::instance().abi_cache_misses.add();
+
+        auto e = load( sql, contract );
+        m_entries.put( contract.value, e );
+        return e;
+    }
+
+    void abi_cache::set( chain::account_name contract, const chain::abi_def& abi ) {
+        try{
+            m_entries.put( contract.value, make_entry( abi ) );
+        } catch(fc::exception& e) {
+            // the next lookup reads it back from the accounts table and fails there as it always did
+            wlog("invalid abi for ${c}: ${e}",("c",contract)("e",e.what()));
+            m_entries.erase( contract.value );
+        }
+    }
+
+    std::shared_ptr<abi_cache::entry> abi_cache::load( soci::session& sql, chain::account_name contract ) {
+        string abi_json;
+        soci::indicator ind;
+        const auto account = contract.to_string();
+        {
+            static auto& abi_latency = metrics::instance().statement("accounts.select_abi");
+            metrics::scoped_timer t(abi_latency);
+            sql << "SELECT abi FROM accounts WHERE name = :name", soci::into(abi_json, ind), soci::use(account);
+        }
+
+        if( ind == soci::i_null ) abi_json.clear();
+        if( abi_json.empty() && contract != chain::config::system_account_name ){
+            wlog("${n} abi is null.",("n",contract));
+            return nullptr;
+        }
+
+        try{
+            if( !abi_json.empty() ){
+                return make_entry( fc::json::from_string(abi_json).as<chain::abi_def>() );
+            }
+            return make_entry( chain::eosio_contract_abi(chain::abi_def()) );
+        } catch(...) {
+            wlog("unable to convert account abi to abi_def for ${s}",("s",contract));
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<abi_cache::entry> abi_cache::make_entry( const chain::abi_def& abi ) {
+        auto e = std::make_shared<entry>();
+        e->serializer.set_abi( abi, m_max_serialization_time );
+        return e;
+    }
+
+} // namespace
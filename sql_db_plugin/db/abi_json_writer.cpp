@@ -0,0 +1,230 @@
+// #include "abi_json_writer.hpp"
+#include <eosio/sql_db_plugin/abi_json_writer.hpp>
+
+#include <eosio/chain/asset.hpp>
+#include <eosio/chain/block_timestamp.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/crypto/hex.hpp>
+
+#include <unordered_map>
+
+namespace eosio {
+
+namespace {
+
+    using stream = fc::datastream<const char*>;
+
+    // nesting limit of abi_serializer
+    const size_t max_depth = 32;
+
+    void append_quoted( string& out, const string& s ) {
+        out += '"';
+        out += s;
+        out += '"';
+    }
+
+    void append_string( string& out, const string& s ) {
+        for( unsigned char c : s ){
+            if( c < 0x20 || c > 0x7e || c == '"' || c == '\\' ){
+                // escapes and utf-8 handling are fc's
+                out += fc::json::to_string( fc::variant(s) );
+                return;
+            }
+        }
+        append_quoted( out, s );
+    }
+
+    // fc::json quotes integers above 0xffffffff, negative ones never
+    void append_int( string& out, int64_t v ) {
+        if( v > 0xffffffff ) append_quoted( out, std::to_string(v) );
+        else out += std::to_string(v);
+    }
+
+    void append_uint( string& out, uint64_t v ) {
+        if( v > 0xffffffff ) append_quoted( out, std::to_string(v) );
+        else out += std::to_string(v);
+    }
+
+    template<typename T>
+    void write_int( string& out, stream& ds ) {
+        T v;
+        fc::raw::unpack( ds, v );
+        if( std::is_signed<T>::value ) append_int( out, int64_t(v) );
+        else append_uint( out, uint64_t(v) );
+    }
+
+    // the rarer built-ins go through a variant like abi_serializer's own
+    template<typename T>
+    void write_variant( string& out, stream& ds ) {
+        T v;
+        fc::raw::unpack( ds, v );
+        out += fc::json::to_string( fc::variant(v) );
+    }
+
+    void write_name( string& out, stream& ds ) {
+        chain::name v;
+        fc::raw::unpack( ds, v );
+        append_quoted( out, v.to_string() );
+    }
+
+    // older abis declare the name typedefs as built-ins
+    bool is_name( const string& type ) {
+        return type == "name" || type == "account_name" || type == "permission_name" || type == "action_name"
+            || type == "table_name" || type == "scope_name";
+    }
+
+    using builtin_writer = void (*)( string&, stream& );
+
+    const std::unordered_map<string, builtin_writer>& builtins() {
+        static const std::unordered_map<string, builtin_writer> writers = {
+            { "bool", []( string& out, stream& ds ){ bool v; fc::raw::unpack( ds, v ); out += v ? "true" : "false"; } },
+            { "int8", write_int<int8_t> },
+            { "uint8", write_int<uint8_t> },
+            { "int16", write_int<int16_t> },
+            { "uint16", write_int<uint16_t> },
+            { "int32", write_int<int32_t> },
+            { "uint32", write_int<uint32_t> },
+            { "int64", write_int<int64_t> },
+            { "uint64", write_int<uint64_t> },
+            { "varint32", []( string& out, stream& ds ){ fc::signed_int v; fc::raw::unpack( ds, v ); append_int( out, v.value ); } },
+            { "varuint32", []( string& out, stream& ds ){ fc::unsigned_int v; fc::raw::unpack( ds, v ); append_uint( out, v.value ); } },
+            { "name", write_name },
+            { "account_name", write_name },
+            { "permission_name", write_name },
+            { "action_name", write_name },
+            { "table_name", write_name },
+            { "scope_name", write_name },
+            { "string", []( string& out, stream& ds ){ string v; fc::raw::unpack( ds, v ); append_string( out, v ); } },
+            { "bytes", []( string& out, stream& ds ){
+                chain::bytes v;
+                fc::raw::unpack( ds, v );
+                append_quoted( out, v.empty() ? string() : fc::to_hex( v.data(), v.size() ) );
+            } },
+            { "asset", []( string& out, stream& ds ){ chain::asset v; fc::raw::unpack( ds, v ); append_quoted( out, v.to_string() ); } },
+            { "public_key", []( string& out, stream& ds ){ chain::public_key_type v; fc::raw::unpack( ds, v ); append_quoted( out, string(v) ); } },
+            { "float32", write_variant<float> },
+            { "float64", write_variant<double> },
+            { "time_point", write_variant<fc::time_point> },
+            { "time_point_sec", write_variant<fc::time_point_sec> },
+            { "block_timestamp_type", write_variant<chain::block_timestamp_type> },
+            { "checksum160", write_variant<chain::checksum160_type> },
+            { "checksum256", write_variant<chain::checksum256_type> },
+            { "checksum512", write_variant<chain::checksum512_type> },
+            { "signature", write_variant<chain::signature_type> },
+            { "symbol", write_variant<chain::symbol> },
+            { "extended_asset", write_variant<chain::extended_asset> },
+        };
+        return writers;
+    }
+
+    // the fields system_contract_arg takes from the variant, when they hold a name
+    chain::account_name* arg_field( system_contract_arg& args, const string& field ) {
+        if( field == "to" ) return &args.to;
+        if( field == "from" ) return &args.from;
+        if( field == "receiver" ) return &args.receiver;
+        if( field == "payer" ) return &args.payer;
+        if( field == "name" ) return &args.name;
+        if( field == "account" ) return &args.account;
+        return nullptr;
+    }
+
+} // namespace
+
+    const string& abi_json_writer::write( const chain::abi_serializer& abis, const string& type, const chain::bytes& data, system_contract_arg* args ) {
+        m_abis = &abis;
+        m_deadline = fc::time_point::now() + m_max_serialization_time;
+        m_out.clear();
+
+        stream ds( data.data(), data.size() );
+        const auto rtype = abis.resolve_type( type );
+        if( args && !abis.is_array(rtype) && !abis.is_optional(rtype) && abis.is_struct(rtype) ){
+            bool first = true;
+            m_out += '{';
+            write_fields( rtype, ds, 1, first, args );
+            m_out += '}';
+        } else {
+            write_type( type, ds, 0 );
+        }
+        return m_out;
+    }
+
+    // checked per struct and array, not per scalar
+    void abi_json_writer::check_deadline() const {
+        FC_ASSERT( fc::time_point::now() < m_deadline, "serialization time limit ${t}us exceeded", ("t",m_max_serialization_time) );
+    }
+
+    void abi_json_writer::write_type( const string& type, stream& ds, size_t depth ) {
+        FC_ASSERT( depth < max_depth, "recursive definition in ${t}", ("t",type) );
+
+        const auto rtype = m_abis->resolve_type( type );
+        const auto ftype = m_abis->fundamental_type( rtype );
+
+        if( m_abis->is_array(rtype) ){
+            fc::unsigned_int size;
+            fc::raw::unpack( ds, size );
+            check_deadline();
+            m_out += '[';
+            for( uint32_t i = 0; i < size.value; ++i ){
+                if( i ) m_out += ',';
+                write_type( ftype, ds, depth + 1 );
+            }
+            m_out += ']';
+        } else if( m_abis->is_optional(rtype) ){
+            char flag;
+            fc::raw::unpack( ds, flag );
+            if( flag ) write_type( ftype, ds, depth + 1 );
+            else m_out += "null";
+        } else if( m_abis->is_builtin_type(rtype) ){
+            const auto& writers = builtins();
+            auto itr = writers.find( rtype );
+            FC_ASSERT( itr != writers.end(), "no json writer for built-in ${t}", ("t",rtype) );
+            itr->second( m_out, ds );
+        } else if( m_abis->is_struct(rtype) ){
+            bool first = true;
+            m_out += '{';
+            write_fields( rtype, ds, depth + 1, first, nullptr );
+            m_out += '}';
+        } else {
+            FC_THROW( "no json writer for type ${t}", ("t",type) );
+        }
+    }
+
+    // base fields first, into the same object, as binary_to_variant does
+    void abi_json_writer::write_fields( const string& type, stream& ds, size_t depth, bool& first, system_contract_arg* args ) {
+        FC_ASSERT( depth < max_depth, "recursive definition in ${t}", ("t",type) );
+        check_deadline();
+        const auto& st = m_abis->get_struct( type );
+        if( !st.base.empty() ){
+            write_fields( m_abis->resolve_type(st.base), ds, depth + 1, first, args );
+        }
+
+        for( const auto& field : st.fields ){
+            if( !first ) m_out += ',';
+            first = false;
+            append_string( m_out, field.name );
+            m_out += ':';
+
+            const stream start = ds;
+            write_type( field.type, ds, depth + 1 );
+
+            // as from_variant does for system_contract_arg: a string that is not a name throws, and so
+            // does any other type, which then goes the binary_to_variant way to fail or convert there
+            auto* arg = args ? arg_field( *args, field.name ) : nullptr;
+            if( !arg ) continue;
+            const auto rtype = m_abis->resolve_type( field.type );
+            stream value = start;
+            if( is_name(rtype) ){
+                fc::raw::unpack( value, *arg );
+            } else if( rtype == "string" ){
+                string s;
+                fc::raw::unpack( value, s );
+                *arg = chain::name(s);
+            } else {
+                FC_THROW( "field ${f} of ${t} is a ${r}, not a name", ("f",field.name)("t",type)("r",rtype) );
+            }
+        }
+    }
+
+} // namespace
@@ -0,0 +1,208 @@
+// #include "account_actions_table.hpp"
+#include <eosio/sql_db_plugin/account_actions_table.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+#include <eosio/sql_db_plugin/sql_dialect.hpp>
+
+#include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
+
+#include <limits>
+
+namespace eosio {
+
+    void account_actions_table::add( const std::set<chain::account_name>& participants, const chain::account_name& contract, const chain::action_name& name,
+                                     uint64_t global_sequence, uint32_t block_num, uint32_t block_time ) {
+        for( const auto& account : participants ){
+            m_accounts.push_back( account.to_string() );
+            m_sequences.push_back( global_sequence );
+            m_contracts.push_back( contract.to_string() );
+            m_names.push_back( name.to_string() );
+            m_block_nums.push_back( block_num );
+            m_timestamps.push_back( block_time );
+        }
+    }
+
+    bool account_actions_table::flush( std::shared_ptr<soci::session> m_session, uint32_t head_block_num ) {
+        // the rows stay buffered until the transaction commits, a failed flush is retried with them
+        try{
+            static auto& flush_latency = metrics::instance().statement("account_actions.flush");
+            static auto& account_action_rows = metrics::instance().rows("account_actions");
+            metrics::scoped_timer t(flush_latency);
+            const auto dialect = sql_dialect::of(*m_session);
+            soci::transaction tr(*m_session);
+            if( !m_accounts.empty() ){
+                *m_session << dialect.insert_ignore("account_actions(account, action_seq, contract, name, block_num, created_at) "
+                                  "VALUES (:ac, :se, :co, :na, :bn, " + dialect.from_unixtime(":ca") + ")"),
+                    soci::use(m_accounts),
+                    soci::use(m_sequences),
+                    soci::use(m_contracts),
+                    soci::use(m_names),
+                    soci::use(m_block_nums),
+                    soci::use(m_timestamps);
+            }
+            if( head_block_num > 0 ){
+                const int head = head_block_num;
+                *m_session << dialect.upsert("sync_status(id, block_num) VALUES (1, :bn)", "id",
+                                  "block_num = " + dialect.excluded("block_num") + ", updated_at = CURRENT_TIMESTAMP"),
+                    soci::use(head);
+            }
+            tr.commit();
+            account_action_rows.add( m_accounts.size() );
+            clear();
+        } catch(soci::soci_error e) {
+            wlog("soci::error: ${e}",("e",e.what()) );
+            return false;
+        } catch(const std::exception& e) {
+            wlog( "flush account actions failed. ${e}",("e",e.what()) );
+            return false;
+        } catch(...) {
+            wlog( "flush account actions failed." );
+            return false;
+        }
+        return true;
+    }
+
+    static void reject_row( dead_letter& rejected, const string& account, long long sequence, const string& contract, const string& name, int block_num, long long timestamp ) {
+        rejected.write( "account_actions", fc::mutable_variant_object()
+            ( "account", account )( "action_seq", int64_t(sequence) )( "contract", contract )( "name", name )
+            ( "block_num", block_num )( "created_at", int64_t(timestamp) ) );
+    }
+
+    bool account_actions_table::flush_apart( std::shared_ptr<soci::session> m_session, uint32_t head_block_num, dead_letter& rejected ) {
+        vector<string> accounts, contracts, names;
+        vector<long long> sequences, timestamps;
+        vector<int> block_nums;
+        accounts.swap( m_accounts );
+        sequences.swap( m_sequences );
+        contracts.swap( m_contracts );
+        names.swap( m_names );
+        block_nums.swap( m_block_nums );
+        timestamps.swap( m_timestamps );
+
+        for( size_t i = 0; i < accounts.size(); ++i ){
+            add_row( accounts[i], sequences[i], contracts[i], names[i], block_nums[i], timestamps[i] );
+            if( flush( m_session, 0 ) ) continue;
+            clear();
+            if( !database_answers(*m_session) ){
+                // this row and the ones after it wait for the next flush
+                for( ; i < accounts.size(); ++i ){
+                    add_row( accounts[i], sequences[i], contracts[i], names[i], block_nums[i], timestamps[i] );
+                }
+                return false;
+            }
+            reject_row( rejected, accounts[i], sequences[i], contracts[i], names[i], block_nums[i], timestamps[i] );
+        }
+        // sync_status, now that every row is written or rejected
+        return flush( m_session, head_block_num );
+    }
+
+    void account_actions_table::reject_all( dead_letter& rejected ) {
+        for( size_t i = 0; i < m_accounts.size(); ++i ){
+            reject_row( rejected, m_accounts[i], m_sequences[i], m_contracts[i], m_names[i], m_block_nums[i], m_timestamps[i] );
+        }
+        clear();
+    }
+
+    void account_actions_table::add_row( const string& account, long long sequence, const string& contract, const string& name, int block_num, long long timestamp ) {
+        m_accounts.push_back( account );
+        m_sequences.push_back( sequence );
+        m_contracts.push_back( contract );
+        m_names.push_back( name );
+        m_block_nums.push_back( block_num );
+        m_timestamps.push_back( timestamp );
+    }
+
+    void account_actions_table::clear() {
+        m_accounts.clear();
+        m_sequences.clear();
+        m_contracts.clear();
+        m_names.clear();
+        m_block_nums.clear();
+        m_timestamps.clear();
+    }
+
+    long long account_actions_table::bound( std::shared_ptr<soci::session> m_session, const string& account, const char* index, const char* column, uint32_t value, bool lower ) {
+        long long seq = 0;
+        const int val = value;
+        soci::indicator ind;
+        const auto dialect = sql_dialect::of(*m_session);
+        string cond = string(column) + (lower ? " >= " : " <= ") + (string(column) == "created_at" ? dialect.from_unixtime(":va") : ":va");
+        string order = lower ? string(column) + ", action_seq" : string(column) + " DESC, action_seq DESC";
+        *m_session << "SELECT action_seq FROM account_actions" + dialect.force_index(index) + " WHERE account = :ac AND " + cond + " ORDER BY " + order + " LIMIT 1",
+            soci::into(seq, ind), soci::use(account), soci::use(val);
+        return m_session->got_data() ? seq : 0;
+    }
+
+    uint32_t account_actions_table::head( std::shared_ptr<soci::session> m_session ) {
+        soci::indicator ind;
+        int head = 0;
+        *m_session << "SELECT block_num FROM sync_status WHERE id = 1", soci::into(head, ind);
+        if( !m_session->got_data() || ind == soci::i_null || head <= 0 ) return 0;
+        return head;
+    }
+
+    account_actions_page account_actions_table::get( std::shared_ptr<soci::session> m_session, const account_actions_query& q ) {
+        account_actions_page page;
+
+        page.head_block_num = head( m_session );
+        if( page.head_block_num == 0 ) return page;
+
+        // block and time bounds become a global sequence range [lo, hi) of the account
+        long long lo = 0;
+        long long hi = q.before > 0 ? q.before : std::numeric_limits<long long>::max();
+        const uint32_t to_block = q.to_block > 0 ? std::min<uint32_t>( q.to_block, page.head_block_num ) : page.head_block_num;
+
+        auto seq = bound( m_session, q.account, "idx_account_block", "block_num", to_block, false );
+        if( seq == 0 ) return page;
+        hi = std::min( hi, seq + 1 );
+        if( q.from_block > 0 ){
+            seq = bound( m_session, q.account, "idx_account_block", "block_num", q.from_block, true );
+            if( seq == 0 ) return page;
+            lo = std::max( lo, seq );
+        }
+        if( q.to_time > 0 ){
+            seq = bound( m_session, q.account, "idx_account_created", "created_at", q.to_time, false );
+            if( seq == 0 ) return page;
+            hi = std::min( hi, seq + 1 );
+        }
+        if( q.from_time > 0 ){
+            seq = bound( m_session, q.account, "idx_account_created", "created_at", q.from_time, true );
+            if( seq == 0 ) return page;
+            lo = std::max( lo, seq );
+        }
+        if( lo >= hi ) return page;
+
+        // the driving index always has the filtered columns as its prefix, so rows come out in
+        // action_seq order straight from the index and the join never sorts
+        const auto dialect = sql_dialect::of(*m_session);
+        const string columns = "SELECT aa.action_seq, aa.block_num, " + dialect.unix_timestamp("a.created_at") + ", a.transaction_id, a.account, a.name, "
+                               "COALESCE(a." + dialect.quote("authorization") + ", '[]'), COALESCE(" + dialect.cast_text("a.data") + ", '{}') ";
+        const string join = dialect.straight_join() + "actions a ON a.global_sequence = aa.action_seq WHERE aa.account = :ac ";
+        const string range = " AND aa.action_seq >= :lo AND aa.action_seq < :hi ORDER BY aa.action_seq DESC LIMIT :li";
+        const int limit = q.limit;
+
+        soci::rowset<soci::row> rs = q.contract.empty()
+            ? ( m_session->prepare << columns + "FROM account_actions aa" + dialect.force_index("PRIMARY") + join + range,
+                soci::use(q.account), soci::use(lo), soci::use(hi), soci::use(limit) )
+            : q.name.empty()
+            ? ( m_session->prepare << columns + "FROM account_actions aa" + dialect.force_index("idx_account_contract") + join + "AND aa.contract = :co" + range,
+                soci::use(q.account), soci::use(q.contract), soci::use(lo), soci::use(hi), soci::use(limit) )
+            : ( m_session->prepare << columns + "FROM account_actions aa" + dialect.force_index("idx_account_contract_name") + join + "AND aa.contract = :co AND aa.name = :na" + range,
+                soci::use(q.account), soci::use(q.contract), soci::use(q.name), soci::use(lo), soci::use(hi), soci::use(limit) );
+
+        for(auto it = rs.begin() ; it != rs.end(); it++){
+            account_action_row row;
+            row.global_sequence = it->get<long long>(0);
+            row.block_num = it->get<int>(1);
+            row.block_time = it->get<long long>(2);
+            row.transaction_id = it->get<string>(3);
+            row.contract = it->get<string>(4);
+            row.name = it->get<string>(5);
+            row.authorization = it->get<string>(6);
+            row.data = it->get<string>(7);
+            page.rows.push_back( std::move(row) );
+        }
+        return page;
+    }
+
+} // namespace
@@ -8,7 +8,7 @@ void accounts_table::add(std::shared_ptr<soci::session> m_session, string name)
     try {
         *m_session << "REPLACE INTO accounts (name) VALUES (:name)",
             soci::use(name);
-    } catch(soci::mysql_soci_error e) {
+    } catch(soci::soci_error e) {
         wlog("soci::error: ${e}",("e",e.what()) );
     } catch (std::exception const & e) {
         wlog( "exception: ${e}",("e",e.what()) );
@@ -22,7 +22,7 @@ void accounts_table::add_eosio(std::shared_ptr<soci::session> m_session, string
     try {
         *m_session << "INSERT INTO accounts (name,abi) VALUES (:name,:abi)",
             soci::use(name),soci::use(abi);
-    } catch(soci::mysql_soci_error e) {
+    } catch(soci::soci_error e) {
         wlog("soci::error: ${e}",("e",e.what()) );
     } catch (std::exception const & e) {
         wlog( "exception: ${e}",("e",e.what()) );
@@ -31,12 +31,23 @@ void accounts_table::add_eosio(std::shared_ptr<soci::session> m_session, string
     } 
 }
 
+std::vector<std::pair<string, string>> accounts_table::get_key_accounts(std::shared_ptr<soci::session> m_session, const string& public_key)
+{
+    std::vector<std::pair<string, string>> result;
+    soci::rowset<soci::row> rs = ( m_session->prepare << "SELECT account, permission FROM accounts_keys WHERE public_key = :pk ORDER BY account, permission",
+        soci::use(public_key) );
+    for( const auto& row : rs ){
+        result.emplace_back( row.get<string>(0), row.get<string>(1) );
+    }
+    return result;
+}
+
 bool accounts_table::exist(std::shared_ptr<soci::session> m_session, string name)
 {
     int amount;
     try {
         *m_session << "SELECT COUNT(*) FROM accounts WHERE name = :name", soci::into(amount), soci::use(name);
-    } catch(soci::mysql_soci_error e) {
+    } catch(soci::soci_error e) {
         wlog("soci::error: ${e}",("e",e.what()) );
     } catch (std::exception const & e) {
         amount = 0;
@@ -0,0 +1,107 @@
+// #include "action_handlers.hpp"
+#include <eosio/sql_db_plugin/action_handlers.hpp>
+#include <eosio/sql_db_plugin/typed_decoders.hpp>
+
+#include <eosio/chain/asset.hpp>
+#include <eosio/chain/contract_types.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+
+namespace eosio {
+
+    action_handlers& action_handlers::instance() {
+        static action_handlers handlers;
+        return handlers;
+    }
+
+    void action_handlers::add( chain::account_name contract, chain::action_name action, handler h ) {
+        m_handlers[ key_type( contract.value, action.value ) ].push_back( std::move(h) );
+    }
+
+    static vector<string> public_keys( const chain::authority& auth ) {
+        vector<string> keys;
+        for( const auto& key : auth.keys ){
+            keys.push_back( static_cast<string>(key.key) );
+        }
+        return keys;
+    }
+
+    // accounts_keys follows the permissions exactly: an update replaces the keys, a delete drops them
+    void index_permission_keys( derived_tables& derived, const chain::action& act ) {
+        if( act.name == chain::newaccount::get_name() ){
+            auto create = act.data_as<chain::newaccount>();
+            const auto name = create.name.to_string();
+            derived.set_permission_keys( name, "owner", public_keys( create.owner ) );
+            derived.set_permission_keys( name, "active", public_keys( create.active ) );
+        } else if( act.name == chain::updateauth::get_name() ){
+            auto update = act.data_as<chain::updateauth>();
+            derived.set_permission_keys( update.account.to_string(), update.permission.to_string(), public_keys( update.auth ) );
+        } else if( act.name == chain::deleteauth::get_name() ){
+            auto remove = act.data_as<chain::deleteauth>();
+            derived.set_permission_keys( remove.account.to_string(), remove.permission.to_string(), vector<string>() );
+        }
+    }
+
+namespace {
+
+    action_handler_registrar on_newaccount( chain::config::system_account_name, chain::newaccount::get_name(), []( const action_context& ctx ){
+        ctx.derived.add_account( ctx.act.data_as<chain::newaccount>().name.to_string() );
+    });
+
+    action_handler_registrar on_voteproducer( chain::config::system_account_name, N(voteproducer), []( const action_context& ctx ){
+        const auto vote = fc::raw::unpack<voteproducer>( ctx.act.data );
+        ctx.derived.set_vote( vote.voter.to_string(), vote.proxy.to_string(), fc::json::to_string( fc::variant(vote.producers) ) );
+        ctx.tally.vote( ctx.sql, vote.voter, vote.producers );
+    });
+
+    // the stake counts for whoever gets the voting power: the receiver of a transferred stake, the payer otherwise
+    action_handler_registrar on_delegatebw( chain::config::system_account_name, N(delegatebw), []( const action_context& ctx ){
+        const auto stake = fc::raw::unpack<delegatebw>( ctx.act.data );
+        const auto amount = stake.stake_net_quantity.get_amount() + stake.stake_cpu_quantity.get_amount();
+        ctx.tally.stake( ctx.sql, stake.transfer ? stake.receiver : stake.from, amount );
+    });
+
+    action_handler_registrar on_undelegatebw( chain::config::system_account_name, N(undelegatebw), []( const action_context& ctx ){
+        const auto unstake = fc::raw::unpack<undelegatebw>( ctx.act.data );
+        const auto amount = unstake.unstake_net_quantity.get_amount() + unstake.unstake_cpu_quantity.get_amount();
+        ctx.tally.stake( ctx.sql, unstake.from, -amount );
+    });
+
+    action_handler_registrar on_propose( N(eosio.msig), N(propose), []( const action_context& ctx ){
+        auto proposer = ctx.data.variant()["proposer"].as<chain::name>().to_string();
+        auto proposal_name = ctx.data.variant()["proposal_name"].as<chain::name>().to_string();
+        auto requested = fc::json::to_string(ctx.data.variant()["requested"]);
+        ctx.derived.set_proposal( proposer, proposal_name, requested );
+    });
+
+    void remove_proposal( const action_context& ctx ) {
+        auto proposer = ctx.data.variant()["proposer"].as<chain::name>().to_string();
+        auto proposal_name = ctx.data.variant()["proposal_name"].as<chain::name>().to_string();
+        ctx.derived.remove_proposal( proposer, proposal_name );
+    }
+
+    action_handler_registrar on_cancel( N(eosio.msig), N(cancel), remove_proposal );
+    action_handler_registrar on_exec( N(eosio.msig), N(exec), remove_proposal );
+
+    // token create on any contract
+    action_handler_registrar on_create( chain::name(), N(create), []( const action_context& ctx ){
+        auto issuer = ctx.data.variant()["issuer"].as<chain::name>().to_string();
+        auto maximum_supply = ctx.data.variant()["maximum_supply"].as<chain::asset>();
+
+        if(issuer.empty() || maximum_supply.get_amount() <= 0){
+            return ;
+        }
+
+        derived_tables::asset_row row;
+        row.max_supply = maximum_supply.get_amount();
+        row.precision = maximum_supply.decimals();
+        row.symbol = maximum_supply.get_symbol().name();
+        row.issuer = issuer;
+        row.contract_owner = ctx.act.account.to_string();
+        ctx.derived.set_asset( row );
+    });
+
+} // namespace
+
+} // namespace
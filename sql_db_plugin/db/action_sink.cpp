@@ -0,0 +1,336 @@
+// #include "action_sink.hpp"
+#include <eosio/sql_db_plugin/action_sink.hpp>
+#include <eosio/sql_db_plugin/sql_dialect.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+#include <eosio/sql_db_plugin/shard_set.hpp>
+
+#include <iterator>
+
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
+
+#ifdef SQL_DB_HAVE_POSTGRESQL
+#include <soci/postgresql/soci-postgresql.h>
+#include <libpq-fe.h>
+#endif
+
+namespace eosio {
+
+    static string action_columns( const sql_dialect& dialect ) {
+        return "account, created_at, name, data, " + dialect.quote("authorization") +
+               ", transaction_id, eosto, eosfrom, receiver, payer, newaccount, sellram_account, global_sequence, block_num, seq, parent";
+    }
+
+    std::shared_ptr<action_sink> action_sink::create( const string& kind, const string& backend_name, std::shared_ptr<dead_letter> rejected ) {
+        std::shared_ptr<action_sink> sink;
+        if( kind == "null" ) sink = std::make_shared<null_action_sink>();
+#ifdef SQL_DB_HAVE_POSTGRESQL
+        else if( kind == "copy" || (kind == "auto" && backend_name == "postgresql") ){
+            FC_ASSERT( backend_name == "postgresql", "the copy sink needs a postgresql:// sql_db-uri" );
+            sink = std::make_shared<copy_action_sink>();
+        }
+#else
+        FC_ASSERT( kind != "copy", "the copy sink needs a build with libpq" );
+#endif
+        if( !sink ){
+            FC_ASSERT( kind == "auto" || kind == "insert" || kind == "copy", "unknown sql_db-sink ${k}", ("k",kind) );
+            sink = std::make_shared<insert_action_sink>();
+        }
+        sink->m_dead_letter = rejected ? std::move(rejected) : std::make_shared<dead_letter>();
+        return sink;
+    }
+
+    void action_sink::reject( const action_row& r ) {
+        m_dead_letter->write( "actions", fc::mutable_variant_object()
+            ( "account", r.account )
+            ( "created_at", int64_t(r.created_at) )
+            ( "name", r.name )
+            ( "data", r.data )
+            ( "authorization", r.authorization )
+            ( "transaction_id", r.transaction_id )
+            ( "eosto", r.eosto )
+            ( "eosfrom", r.eosfrom )
+            ( "receiver", r.receiver )
+            ( "payer", r.payer )
+            ( "newaccount", r.newaccount )
+            ( "sellram_account", r.sellram_account )
+            ( "global_sequence", int64_t(r.global_sequence) )
+            ( "block_num", r.block_num )
+            ( "seq", r.seq )
+            ( "parent", int64_t(r.parent) ) );
+    }
+
+    void action_sink::reject_all() {
+        for( const auto& r : m_rows ) reject( r );
+        m_rows.clear();
+    }
+
+    bool action_sink::flush_apart( soci::session& sql ) {
+        vector<action_row> rows;
+        rows.swap( m_rows );
+        for( size_t i = 0; i < rows.size(); ++i ){
+            m_rows.push_back( std::move(rows[i]) );
+            if( flush( sql ) ) continue;
+            if( !database_answers(sql) ){
+                // this row and the ones after it wait for the next flush
+                std::move( rows.begin() + i + 1, rows.end(), std::back_inserter(m_rows) );
+                return false;
+            }
+            reject( m_rows.back() );
+            m_rows.clear();
+        }
+        return true;
+    }
+
+    // rows [begin, end) in one multi-row INSERT and transaction. The strings are moved into the bound
+    // columns, and back into the rows if the insert throws
+    static void insert_rows( soci::session& sql, vector<action_row>& rows, size_t begin, size_t end ) {
+        vector<string> accounts, names, datas, auths, trx_ids, tos, froms, receivers, payers, newaccounts, sellram_accounts;
+        vector<long long> created, sequences, parents;
+        vector<int> block_nums, seqs;
+        for( size_t i = begin; i < end; ++i ){
+            auto& r = rows[i];
+            accounts.push_back( std::move(r.account) );
+            created.push_back( r.created_at );
+            names.push_back( std::move(r.name) );
+            datas.push_back( std::move(r.data) );
+            auths.push_back( std::move(r.authorization) );
+            trx_ids.push_back( std::move(r.transaction_id) );
+            tos.push_back( std::move(r.eosto) );
+            froms.push_back( std::move(r.eosfrom) );
+            receivers.push_back( std::move(r.receiver) );
+            payers.push_back( std::move(r.payer) );
+            newaccounts.push_back( std::move(r.newaccount) );
+            sellram_accounts.push_back( std::move(r.sellram_account) );
+            sequences.push_back( r.global_sequence );
+            block_nums.push_back( r.block_num );
+            seqs.push_back( r.seq );
+            parents.push_back( r.parent );
+        }
+
+        try{
+            const auto dialect = sql_dialect::of(sql);
+            soci::transaction tr(sql);
+            // rows are keyed by global sequence, a batch written again leaves the stored rows as they are
+            multi_row_insert( sql, "INSERT INTO actions(" + action_columns(dialect) + ")",
+                              "(?, " + dialect.from_unixtime("?") + ", ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", dialect.keep_existing("global_sequence") )
+                .column(accounts).column(created).column(names).column(datas).column(auths).column(trx_ids)
+                .column(tos).column(froms).column(receivers).column(payers).column(newaccounts).column(sellram_accounts)
+                .column(sequences).column(block_nums).column(seqs).column(parents)
+                .execute();
+            tr.commit();
+        } catch(...) {
+            for( size_t i = begin; i < end; ++i ){
+                auto& r = rows[i];
+                const size_t j = i - begin;
+                r.account = std::move(accounts[j]);
+                r.name = std::move(names[j]);
+                r.data = std::move(datas[j]);
+                r.authorization = std::move(auths[j]);
+                r.transaction_id = std::move(trx_ids[j]);
+                r.eosto = std::move(tos[j]);
+                r.eosfrom = std::move(froms[j]);
+                r.receiver = std::move(receivers[j]);
+                r.payer = std::move(payers[j]);
+                r.newaccount = std::move(newaccounts[j]);
+                r.sellram_account = std::move(sellram_accounts[j]);
+            }
+            throw;
+        }
+    }
+
+    bool insert_action_sink::try_insert( soci::session& sql, vector<action_row>& rows, size_t begin, size_t end ) {
+        static auto& action_rows = metrics::instance().rows("actions");
+        try{
+            insert_rows( sql, rows, begin, end );
+            action_rows.add( end - begin );
+            return true;
+        } catch(soci::soci_error e) {
+            wlog("soci::error: ${e}",("e",e.what()) );
+        } catch(const std::exception& e) {
+            wlog( "flush actions failed. ${e}",("e",e.what()) );
+        } catch(...) {
+            wlog( "flush actions failed." );
+        }
+        return false;
+    }
+
+    // [begin, end) was refused as a whole while the database answered: each half is tried alone down
+    // to the single rows it refuses, which go to the dead letter file. Once the database stops
+    // answering the rows not yet written go to left, in order, for the next flush
+    void insert_action_sink::split( soci::session& sql, vector<action_row>& rows, size_t begin, size_t end, vector<action_row>& left ) {
+        if( end - begin == 1 ){
+            reject( rows[begin] );
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        for( const auto& half : { std::make_pair(begin, mid), std::make_pair(mid, end) } ){
+            if( left.empty() && try_insert( sql, rows, half.first, half.second ) ) continue;
+            if( left.empty() && database_answers(sql) ){
+                split( sql, rows, half.first, half.second, left );
+            } else {
+                std::move( rows.begin() + half.first, rows.begin() + half.second, std::back_inserter(left) );
+            }
+        }
+    }
+
+    bool insert_action_sink::flush( soci::session& sql ) {
+        if( m_rows.empty() ) return true;
+        static auto& flush_latency = metrics::instance().statement("actions.flush");
+        metrics::scoped_timer t(flush_latency);
+
+        if( try_insert( sql, m_rows, 0, m_rows.size() ) ){
+            m_rows.clear();
+            return true;
+        }
+        // nothing was committed and the rows are back in m_rows; an unreachable database keeps them all
+        if( !database_answers(sql) ) return false;
+
+        // one bad row must not hold back the rest of the batch
+        vector<action_row> rows, left;
+        rows.swap(m_rows);
+        split( sql, rows, 0, rows.size(), left );
+        m_rows.swap(left);
+        return m_rows.empty();
+    }
+
+#ifdef SQL_DB_HAVE_POSTGRESQL
+    // text format: tab separated, \N for null, backslash escapes
+    static void copy_field( string& out, const string& value ) {
+        for( char c : value ){
+            switch( c ){
+                case '\\':  out += "\\\\"; break;
+                case '\t':  out += "\\t"; break;
+                case '\n':  out += "\\n"; break;
+                case '\r':  out += "\\r"; break;
+                default:    out += c;
+            }
+        }
+    }
+
+    bool copy_action_sink::flush( soci::session& sql ) {
+        if( m_rows.empty() ) return true;
+        static auto& flush_latency = metrics::instance().statement("actions.copy");
+        static auto& action_rows = metrics::instance().rows("actions");
+        metrics::scoped_timer t(flush_latency);
+
+        // the rows stay buffered until they are in actions
+        string buffer;
+        for( const auto& r : m_rows ){
+            copy_field( buffer, r.account );                                            buffer += '\t';
+            buffer += fc::time_point_sec( r.created_at ).to_iso_string();               buffer += '\t';
+            copy_field( buffer, r.name );                                               buffer += '\t';
+            copy_field( buffer, r.data );                                               buffer += '\t';
+            copy_field( buffer, r.authorization );                                      buffer += '\t';
+            copy_field( buffer, r.transaction_id );                                     buffer += '\t';
+            copy_field( buffer, r.eosto );                                              buffer += '\t';
+            copy_field( buffer, r.eosfrom );                                            buffer += '\t';
+            copy_field( buffer, r.receiver );                                           buffer += '\t';
+            copy_field( buffer, r.payer );                                              buffer += '\t';
+            copy_field( buffer, r.newaccount );                                         buffer += '\t';
+            copy_field( buffer, r.sellram_account );                                    buffer += '\t';
+            buffer += std::to_string( r.global_sequence );                              buffer += '\t';
+            buffer += std::to_string( r.block_num );                                    buffer += '\t';
+            buffer += std::to_string( r.seq );                                          buffer += '\t';
+            buffer += std::to_string( r.parent );                                       buffer += '\n';
+        }
+
+        auto* backend = static_cast<soci::postgresql_session_backend*>( sql.get_backend() );
+        PGconn* conn = backend->conn_;
+        // COPY has no conflict clause: the rows go to a session-local staging table and from there
+        // into actions, skipping the global sequences already stored
+        const auto columns = action_columns( sql_dialect("postgresql") );
+        try{
+            PGresult* res = PQexec( conn, "CREATE TEMP TABLE IF NOT EXISTS actions_load (LIKE actions INCLUDING DEFAULTS); TRUNCATE actions_load" );
+            const bool staged = PQresultStatus(res) == PGRES_COMMAND_OK;
+            PQclear(res);
+            FC_ASSERT( staged, "staging actions failed: ${e}", ("e",PQerrorMessage(conn)) );
+
+            res = PQexec( conn, ("COPY actions_load(" + columns + ") FROM STDIN").c_str() );
+            const bool started = PQresultStatus(res) == PGRES_COPY_IN;
+            PQclear(res);
+            FC_ASSERT( started, "COPY actions failed: ${e}", ("e",PQerrorMessage(conn)) );
+
+            const size_t chunk = 1 << 20;
+            bool sent = true;
+            for( size_t pos = 0; pos < buffer.size() && sent; pos += chunk ){
+                sent = PQputCopyData( conn, buffer.data() + pos, std::min(chunk, buffer.size() - pos) ) == 1;
+            }
+            PQputCopyEnd( conn, sent ? nullptr : "client write failed" );
+
+            bool ok = sent;
+            while( (res = PQgetResult(conn)) != nullptr ){
+                ok = ok && PQresultStatus(res) == PGRES_COMMAND_OK;
+                PQclear(res);
+            }
+            FC_ASSERT( ok, "COPY actions failed: ${e}", ("e",PQerrorMessage(conn)) );
+
+            res = PQexec( conn, ("INSERT INTO actions(" + columns + ") SELECT " + columns + " FROM actions_load ON CONFLICT (global_sequence) DO NOTHING").c_str() );
+            ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+            PQclear(res);
+            FC_ASSERT( ok, "moving staged actions failed: ${e}", ("e",PQerrorMessage(conn)) );
+            action_rows.add( m_rows.size() );
+            m_rows.clear();
+        } catch(fc::exception& e) {
+            wlog("${e}",("e",e.to_string()));
+            return false;
+        } catch(std::exception& e) {
+            wlog( "copy actions failed. ${e}",("e",e.what()) );
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    bool sharded_action_sink::flush( soci::session& sql ) {
+        return flush_shards( sql, false );
+    }
+
+    bool sharded_action_sink::flush_apart( soci::session& sql ) {
+        return flush_shards( sql, true );
+    }
+
+    // only shard 0 holds up the batch. Another shard that fails keeps its rows in its sink and is tried
+    // again once its backoff passes, writing a row at a time after flush_retries failures in a row
+    bool sharded_action_sink::flush_shards( soci::session& sql, bool apart ) {
+        for( auto& r : m_rows ){
+            const auto shard = m_shards->of( chain::name(r.account) );
+            m_sinks[shard]->add( std::move(r) );
+        }
+        m_rows.clear();
+
+        const bool ok = m_sinks[0]->flush( sql ) || (apart && m_sinks[0]->flush_apart( sql ));
+        for( size_t i = 1; i < m_sinks.size(); ++i ){
+            auto& sink = *m_sinks[i];
+            if( sink.size() == 0 || !m_shards->due(i) ) continue;
+            bool written = false;
+            try{
+                auto session = m_shards->get_session(i);
+                written = sink.flush( *session ) || (m_shards->failures(i) >= m_shards->flush_retries && sink.flush_apart( *session ));
+            } catch(std::exception& e) {
+                wlog( "flush actions of shard ${s} failed. ${e}",("s",i)("e",e.what()) );
+            }
+            if( written ){
+                m_shards->succeeded(i);
+                continue;
+            }
+            m_shards->failed(i);
+            wlog( "shard ${s} failed ${f} times in a row, holding back ${n} actions",("s",i)("f",m_shards->failures(i))("n",sink.size()) );
+            if( sink.size() > m_shards->backlog_limit ){
+                elog( "shard ${s} holds back more than ${l} actions, they go to the dead letter file",("s",i)("l",m_shards->backlog_limit) );
+                sink.reject_all();
+            }
+        }
+        return ok;
+    }
+
+    void sharded_action_sink::reject_backlog() {
+        for( size_t i = 1; i < m_sinks.size(); ++i ){
+            if( m_sinks[i]->size() == 0 ) continue;
+            wlog( "shard ${s} still holds back ${n} actions, they go to the dead letter file",("s",i)("n",m_sinks[i]->size()) );
+            m_sinks[i]->reject_all();
+        }
+    }
+
+} // namespace
@@ -36,7 +36,7 @@ namespace eosio {
                         soci::use(new_producers),
                         soci::use(block_id_str);
             }
-        } catch(soci::mysql_soci_error e) {
+        } catch(soci::soci_error e) {
             wlog("soci::error: ${e}",("e",e.what()) );
         } catch(std::exception e) {
             wlog( "add blocks failed. ${e}",("e",e.what()) );
@@ -61,7 +61,7 @@ namespace eosio {
                 if(amount==0) return true;
             }
             // wlog( "${amount}",("amount",amount) );
-        } catch(soci::mysql_soci_error e) {
+        } catch(soci::soci_error e) {
             wlog("soci::error: ${e}",("e",e.what()) );
         } catch(std::exception e) {
             wlog( "update block irreversible failed.block id:${id},error: ${e}",("id",block_id)("e",e.what()) );
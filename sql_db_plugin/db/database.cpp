@@ -1,15 +1,43 @@
 // #include "database.hpp"
 #include <eosio/sql_db_plugin/database.hpp>
+#include <eosio/sql_db_plugin/action_handlers.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
 
 namespace eosio
 {
 
+    // the actions dfs_inline_traces would walk below a trace
+    // the highest global sequence of the trace, where apply_status resumes
+    static uint64_t last_global_sequence( const vector<chain::action_trace>& trace ){
+        uint64_t last = 0;
+        for( const auto& atc : trace ){
+            last = std::max( { last, atc.receipt.global_sequence, last_global_sequence( atc.inline_traces ) } );
+        }
+        return last;
+    }
+
+    static uint32_t count_actions( const vector<chain::action_trace>& trace ){
+        uint32_t n = 0;
+        for( const auto& atc : trace ){
+            if( atc.receipt.receiver == atc.act.account ) n += 1 + count_actions( atc.inline_traces );
+        }
+        return n;
+    }
+
     sql_database::sql_database(const std::string &uri, uint32_t block_num_start, size_t pool_size) {
         m_session_pool          = std::make_shared<soci_session_pool>(pool_size,uri);
         m_accounts_table        = std::make_unique<accounts_table>();
         m_blocks_table          = std::make_unique<blocks_table>();
         m_transactions_table    = std::make_unique<transactions_table>();
         m_actions_table         = std::make_unique<actions_table>();
+        m_dead_letter           = std::make_shared<dead_letter>();
+        m_actions_table->m_sink = action_sink::create( "auto", m_session_pool->get_session()->get_backend_name(), m_dead_letter );
+        m_tokens_table          = std::make_unique<tokens_table>();
+        m_account_actions_table = std::make_unique<account_actions_table>();
+        m_rollup_tables         = std::make_unique<rollup_tables>();
         m_block_num_start       = block_num_start;
         system_account          = chain::name(chain::config::system_account_name).to_string();
     }
@@ -42,7 +70,7 @@ namespace eosio
                 if(trx.actions.size()==1 && trx.actions[0].name.to_string() == "onblock" ) continue ;
 
                 for(auto actions : trx.actions){
-                    m_actions_table->add( m_session_pool->get_session(), actions,trx.id(), bs->block->timestamp, m_action_filter_on);
+                    m_actions_table->add( m_session_pool->get_session(), actions,trx.id(), bs->block->timestamp, m_action_filter_on, 0, bs->block_num);
                 }
 
             }         
@@ -52,19 +80,347 @@ namespace eosio
 
     void sql_database::consume_transaction_trace( const chain::transaction_trace_ptr& tc ){
         // ilog("${t} ${id}",("t",tbt.block_time)("id",tbt.trace->id.str()));
+        // onblock is not stored, it only tells the producer of the traces that follow
+        if( tc->action_traces.size()==1 && tc->action_traces[0].act.name == N(onblock) ){
+            if( tc->block_num == m_producer_block_num ) return;
+            try{
+                m_block_producer = fc::raw::unpack<chain::block_header>( tc->action_traces[0].act.data ).producer;
+            } catch(fc::exception& e) {
+                wlog( "unpack onblock failed. ${e}",("e",e.to_string()) );
+                return;
+            }
+            m_producer_block_num = tc->block_num;
+            m_rollup_tables->begin_trace( last_global_sequence( tc->action_traces ) );
+            m_rollup_tables->add_block( m_block_producer, tc->block_time );
+            return;
+        }
+
         auto session = m_session_pool->get_session();
-        dfs_inline_traces( session, tc->action_traces, tc->id, tc->block_time  );
+        if( m_dedup && is_duplicate( *session, tc ) ){
+            metrics::instance().traces_duplicate.add();
+            return;
+        }
+        const auto sequence = last_global_sequence( tc->action_traces );
+        m_rollup_tables->begin_trace( sequence );
+        m_actions_table->m_vote_tally.begin_trace( sequence );
+        m_tokens_table->begin_trace( sequence );
+        if( tc->block_num == m_producer_block_num ) m_rollup_tables->add_transaction( m_block_producer, tc->block_time );
+        uint32_t ordinal = 0;
+        dfs_inline_traces( session, tc->action_traces, tc->id, tc->block_time, tc->block_num, ordinal, 0 );
+        index_inline_traces( session, tc->action_traces, tc->block_time );
+        m_last_block_num = tc->block_num;
     }
 
-    void sql_database::dfs_inline_traces( std::shared_ptr<soci::session> session, vector<chain::action_trace> trace,  chain::transaction_id_type transaction_id, chain::block_timestamp_type block_time ){
+    // ids the dedup set only may have seen are looked up among the stored actions
+    bool sql_database::is_duplicate( soci::session& sql, const chain::transaction_trace_ptr& tc ){
+        switch( m_dedup->check( tc->id, tc->block_time ) ){
+            case trx_dedup::fresh:      return false;
+            case trx_dedup::duplicate:  return true;
+            default:                    break;
+        }
+        const auto id = tc->id.str();
+        int found = 0;
+        sql << "SELECT 1 FROM actions WHERE transaction_id = :id LIMIT 1", soci::use( id ), soci::into( found );
+        if( sql.got_data() ) return true;
+        // the actions of a transaction may be on any shard. A shard that is down counts as not having
+        // them, writing a transaction again leaves its stored actions as they are
+        for( size_t i = 1; m_shards && i < m_shards->size(); ++i ){
+            if( !m_shards->due(i) ) continue;
+            try{
+                auto shard = m_shards->get_session(i);
+                *shard << "SELECT 1 FROM actions WHERE transaction_id = :id LIMIT 1", soci::use( id ), soci::into( found );
+                if( shard->got_data() ) return true;
+            } catch(std::exception& e) {
+                wlog( "looking up ${id} on shard ${s} failed. ${e}",("id",id)("s",i)("e",e.what()) );
+            }
+        }
+        return false;
+    }
+
+    // ordinals follow the walk of the whole tree, the subtree of a stored action included, so an
+    // action gets the same (seq, parent) whatever the action filter stores. parent is an ordinal too,
+    // with (transaction_id, parent) the sender is found whenever it was stored
+    void sql_database::dfs_inline_traces( std::shared_ptr<soci::session> session, const vector<chain::action_trace>& trace,  chain::transaction_id_type transaction_id, chain::block_timestamp_type block_time, uint32_t block_num,
+                                          uint32_t& ordinal, uint32_t parent ){
         for(auto& atc : trace){
             if( atc.receipt.receiver == atc.act.account ){
-                auto is_success = m_actions_table->add( session, atc.act, transaction_id, block_time, m_action_filter_on );
+                const uint32_t seq = ++ordinal;
+                auto is_success = m_actions_table->add( session, atc.act, transaction_id, block_time, m_action_filter_on, atc.receipt.global_sequence, block_num,
+                                                        seq, parent );
+                if( is_success ) m_rollup_tables->add_action( atc.act.account, atc.act.name, block_time );
+                if( is_success && m_actions_table->m_sink->stores_rows() ){
+                    // the contract, its authorizers and every account notified of the action
+                    std::set<chain::account_name> participants;
+                    participants.insert( atc.act.account );
+                    for( const auto& auth : atc.act.authorization ){
+                        participants.insert( auth.actor );
+                    }
+                    for( const auto& notified : atc.inline_traces ){
+                        if( notified.receipt.receiver != notified.act.account ) participants.insert( notified.receipt.receiver );
+                    }
+                    account_actions_of( m_shards ? m_shards->of(atc.act.account) : 0 ).add( participants, atc.act.account, atc.act.name, atc.receipt.global_sequence, block_num,
+                                                  block_time.operator fc::time_point().sec_since_epoch() );
+                }
                 if( !is_success && atc.inline_traces.size()!=0 ){
-                    dfs_inline_traces( session, atc.inline_traces, transaction_id, block_time );
+                    dfs_inline_traces( session, atc.inline_traces, transaction_id, block_time, block_num, ordinal, seq );
+                } else {
+                    ordinal += count_actions( atc.inline_traces );
                 }
             }
         }
     }
 
+    void sql_database::load_apply_status() {
+        auto session = m_session_pool->get_session();
+        m_rollup_tables->load_status( *session );
+        m_actions_table->m_vote_tally.load_status( *session );
+        m_tokens_table->load_status( *session );
+    }
+
+    void sql_database::load_token_registry() {
+        const int page_size = 1000;
+        auto session = m_session_pool->get_session();
+        long long last_id = 0;
+        int rows_read = 0;
+        do {
+            rows_read = 0;
+            auto rows = m_actions_table->get_assets_after( session, last_id, page_size );
+            for(auto it = rows.begin() ; it != rows.end(); it++){
+                token_registry::token_info t;
+                t.contract = chain::name(it->get<string>(0));
+                t.issuer = chain::name(it->get<string>(1));
+                t.precision = it->get<int>(2);
+                t.symbol = it->get<string>(3);
+                t.id = it->get<long long>(4);
+                m_token_registry->add( t );
+                last_id = t.id;
+                ++rows_read;
+            }
+        } while( rows_read == page_size );
+        ilog("token registry loaded: ${n} tokens",("n",m_token_registry->size()));
+    }
+
+    // keeps the in-memory indexes in step with every executed action, regardless of the action filter
+    void sql_database::index_inline_traces( std::shared_ptr<soci::session> session, const vector<chain::action_trace>& trace, chain::block_timestamp_type block_time ){
+        for(auto& atc : trace){
+            if( atc.receipt.receiver == atc.act.account ){
+                if( m_proposal_index && atc.act.account == N(eosio.msig) ){
+                    m_proposal_index->apply( atc.act );
+                }
+                if( m_token_registry && atc.act.account == chain::config::system_account_name && atc.act.name == actions_table::setabi ){
+                    m_token_registry->invalidate_abi( atc.act.data_as<chain::setabi>().account );
+                }
+                if( atc.act.account == chain::config::system_account_name ){
+                    index_permission_keys( m_actions_table->m_derived, atc.act );
+                }
+                if( atc.act.name == N(transfer) || atc.act.name == N(issue) || atc.act.name == N(retire) ){
+                    index_token_action( session, atc.act, block_time );
+                }
+            }
+            index_inline_traces( session, atc.inline_traces, block_time );
+        }
+    }
+
+    // only tokens known to the registry or created in the batch are tracked, which also rules out look-alike actions of other contracts
+    void sql_database::index_token_action( std::shared_ptr<soci::session> session, const chain::action& act, chain::block_timestamp_type block_time ){
+        chain::account_name from;
+        chain::account_name to;
+        chain::asset quantity;
+        try{
+            if( act.name == N(transfer) ){
+                auto data = fc::raw::unpack<token_transfer>( act.data );
+                from = data.from;
+                to = data.to;
+                quantity = data.quantity;
+            } else if( act.name == N(issue) ){
+                auto data = fc::raw::unpack<token_issue>( act.data );
+                to = data.to;
+                quantity = data.quantity;
+            } else {
+                quantity = fc::raw::unpack<token_retire>( act.data ).quantity;
+            }
+        } catch(fc::exception& e) {
+            return;
+        }
+
+        if( !m_token_registry ) return;
+        auto token = m_token_registry->find( act.account, quantity.get_symbol().name() );
+        // created in this batch, the registry only has it once the batch commits
+        if( !token ) token = m_actions_table->m_derived.pending_token( act.account, quantity.get_symbol().name() );
+        if( !token || token->precision != quantity.decimals() ) return;
+
+        if( act.name == N(transfer) ){
+            m_tokens_table->add_balance( from, act.account, -quantity );
+            m_tokens_table->add_balance( to, act.account, quantity );
+            m_rollup_tables->add_transfer( act.account, quantity, block_time );
+        } else if( act.name == N(issue) ){
+            // the token contract credits the issuer and forwards with an inline transfer
+            m_tokens_table->add_supply( act.account, quantity );
+            m_tokens_table->add_balance( token->issuer, act.account, quantity );
+        } else {
+            m_tokens_table->add_supply( act.account, -quantity );
+            m_tokens_table->add_balance( token->issuer, act.account, -quantity );
+        }
+
+        if( to != chain::account_name() && m_holder_index && m_holder_index->should_write( to, act.account ) ){
+            m_tokens_table->add_holder( session, to.to_string(), act.account.to_string() );
+            m_holder_index->written( to, act.account );
+        }
+    }
+
+    std::shared_ptr<soci::session> sql_database::get_read_session(){
+        if( m_read_router ) return m_read_router->get_session();
+        return m_session_pool->get_session();
+    }
+
+    void sql_database::set_action_sink( const std::string& kind ){
+        m_actions_table->m_sink = action_sink::create( kind, m_session_pool->get_session()->get_backend_name(), m_dead_letter );
+        if( !m_shards ) return;
+
+        std::vector<std::shared_ptr<action_sink>> sinks{ m_actions_table->m_sink };
+        for( size_t i = 1; i < m_shards->size(); ++i ){
+            sinks.push_back( action_sink::create( kind, m_shards->get_session(i)->get_backend_name(), m_dead_letter ) );
+        }
+        m_actions_table->m_sink = std::make_shared<sharded_action_sink>( m_shards, std::move(sinks) );
+    }
+
+    void sql_database::set_shards( const std::vector<std::string>& shard_uris, size_t pool_size ){
+        if( shard_uris.empty() ) return;
+        m_shards = std::make_shared<shard_set>( m_session_pool, shard_uris, pool_size );
+        for( size_t i = 1; i < m_shards->size(); ++i ){
+            m_shard_account_actions.push_back( std::make_unique<account_actions_table>() );
+        }
+    }
+
+    void sql_database::check_shards( const std::vector<std::string>& uris ){
+        auto session = m_session_pool->get_session();
+        std::vector<std::string> recorded;
+        soci::rowset<soci::row> rows = (session->prepare << "SELECT uri FROM shards ORDER BY shard");
+        for( const auto& row : rows ){
+            recorded.push_back( row.get<std::string>(0) );
+        }
+
+        std::vector<std::string> configured;
+        for( const auto& uri : uris ){
+            configured.push_back( shard_set::without_password( uri ) );
+        }
+        if( recorded.empty() ){
+            soci::transaction tr(*session);
+            for( size_t i = 0; i < configured.size(); ++i ){
+                const int shard = i;
+                *session << "INSERT INTO shards(shard, uri) VALUES (:s, :u)", soci::use(shard), soci::use(configured[i]);
+            }
+            tr.commit();
+            return;
+        }
+        FC_ASSERT( recorded.size() == configured.size(),
+                   "the database was written with ${r} shards and sql_db-uri gives ${c}, contracts would hash to other shards",
+                   ("r",recorded.size())("c",configured.size()) );
+        for( size_t i = 0; i < recorded.size(); ++i ){
+            FC_ASSERT( recorded[i] == configured[i],
+                       "shard ${i} was ${r} and sql_db-uri gives ${c}; if the database only moved, update its row in the shards table",
+                       ("i",i)("r",recorded[i])("c",configured[i]) );
+        }
+    }
+
+    account_actions_table& sql_database::account_actions_of( size_t shard ){
+        return shard == 0 ? *m_account_actions_table : *m_shard_account_actions.at( shard - 1 );
+    }
+
+    // every shard is read up to the lowest sync_status of them all, so a shard running ahead cannot
+    // fill a page with blocks the next page's cursor would skip on the others
+    account_actions_page sql_database::get_account_actions( const account_actions_query& q ){
+        if( !m_shards ) return m_account_actions_table->get( get_read_session(), q );
+
+        std::vector<std::shared_ptr<soci::session>> sessions{ get_read_session() };
+        for( size_t i = 1; i < m_shards->size(); ++i ){
+            sessions.push_back( m_shards->get_session(i) );
+        }
+        uint32_t head = std::numeric_limits<uint32_t>::max();
+        for( const auto& session : sessions ){
+            head = std::min( head, m_account_actions_table->head( session ) );
+        }
+        account_actions_page page;
+        if( head == 0 ) return page;
+
+        auto bounded = q;
+        bounded.to_block = q.to_block > 0 ? std::min( q.to_block, head ) : head;
+        for( size_t i = 0; i < sessions.size(); ++i ){
+            auto shard_page = account_actions_of(i).get( sessions[i], bounded );
+            std::move( shard_page.rows.begin(), shard_page.rows.end(), std::back_inserter(page.rows) );
+        }
+        std::sort( page.rows.begin(), page.rows.end(), []( const account_action_row& a, const account_action_row& b ){
+            return a.global_sequence > b.global_sequence;
+        });
+        if( page.rows.size() > q.limit ) page.rows.resize( q.limit );
+        page.head_block_num = head;
+        return page;
+    }
+
+    // called by the consumer at the end of every batch of traces
+    bool sql_database::flush( bool apart ){
+        auto& sink = *m_actions_table->m_sink;
+        auto& derived = m_actions_table->m_derived;
+        auto& tally = m_actions_table->m_vote_tally;
+        auto& rejected = *m_dead_letter;
+        // each step depends on the rows of the ones before it, so a failure ends the batch here and
+        // the next call starts again from the step that failed
+        if( !sink.flush( *m_session_pool->get_session() ) && !(apart && sink.flush_apart( *m_session_pool->get_session() )) ) return false;
+        // before the tokens, whose supply updates need the assets rows
+        if( !derived.flush( *m_session_pool->get_session(), m_token_registry, m_key_index ) &&
+            !(apart && derived.flush_apart( *m_session_pool->get_session(), m_token_registry, m_key_index, rejected )) ) return false;
+        if( !tally.flush( *m_session_pool->get_session() ) && !(apart && tally.flush_apart( *m_session_pool->get_session(), rejected )) ) return false;
+        if( !m_tokens_table->flush( m_session_pool->get_session() ) && !(apart && m_tokens_table->flush_apart( m_session_pool->get_session(), rejected )) ) return false;
+        // traces of the last block may continue in the next batch, only the blocks before it are complete
+        const uint32_t head = m_last_block_num > 0 ? m_last_block_num - 1 : 0;
+        if( !m_account_actions_table->flush( m_session_pool->get_session(), head ) &&
+            !(apart && m_account_actions_table->flush_apart( m_session_pool->get_session(), head, rejected )) ) return false;
+        flush_shard_account_actions( head );
+        if( !m_rollup_tables->flush( *m_session_pool->get_session() ) && !(apart && m_rollup_tables->flush_apart( *m_session_pool->get_session(), rejected )) ) return false;
+        return true;
+    }
+
+    // like their action sinks, the other shards do not hold up the batch: a shard that fails keeps its
+    // rows and its sync_status behind and is tried again once its backoff passes
+    void sql_database::flush_shard_account_actions( uint32_t head ){
+        for( size_t i = 1; m_shards && i < m_shards->size(); ++i ){
+            if( !m_shards->due(i) ) continue;
+            auto& table = account_actions_of(i);
+            bool written = false;
+            try{
+                auto session = m_shards->get_session(i);
+                written = table.flush( session, head ) ||
+                          (m_shards->failures(i) >= m_shards->flush_retries && table.flush_apart( session, head, *m_dead_letter ));
+            } catch(std::exception& e) {
+                wlog( "flush account actions of shard ${s} failed. ${e}",("s",i)("e",e.what()) );
+            }
+            if( written ){
+                m_shards->succeeded(i);
+                continue;
+            }
+            m_shards->failed(i);
+            if( table.size() > m_shards->backlog_limit ){
+                elog( "shard ${s} holds back more than ${l} account actions, they go to the dead letter file",("s",i)("l",m_shards->backlog_limit) );
+                table.reject_all( *m_dead_letter );
+            }
+        }
+    }
+
+    void sql_database::drain_shards(){
+        if( !m_shards ) return;
+        m_shards->retry_all();
+        try{
+            flush();
+        } catch(std::exception& e) {
+            wlog( "last flush failed. ${e}",("e",e.what()) );
+        }
+        m_actions_table->m_sink->reject_backlog();
+        for( size_t i = 1; i < m_shards->size(); ++i ){
+            auto& table = account_actions_of(i);
+            if( table.size() == 0 ) continue;
+            wlog( "shard ${s} still holds back ${n} account actions, they go to the dead letter file",("s",i)("n",table.size()) );
+            table.reject_all( *m_dead_letter );
+        }
+    }
+
 } // namespace
@@ -0,0 +1,44 @@
+// #include "dead_letter.hpp"
+#include <eosio/sql_db_plugin/dead_letter.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/time.hpp>
+#include <fc/variant_object.hpp>
+
+namespace eosio {
+
+    dead_letter::dead_letter( const string& path )
+        : m_path(path),
+          m_out(path, std::ios::app) {
+        FC_ASSERT( m_out.good(), "unable to open ${p}", ("p",path) );
+    }
+
+    void dead_letter::write( const string& table, const fc::variant& row ) {
+        const auto json = fc::json::to_string( fc::mutable_variant_object()
+            ( "time", fc::time_point::now() )
+            ( "table", table )
+            ( "row", row ) );
+        elog( "${t} row refused by the database: ${r}", ("t",table)("r",json) );
+        metrics::instance().rows_rejected.add();
+        if( m_path.empty() ) return;
+
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_out << json << "\n";
+        m_out.flush();
+        if( !m_out.good() ) elog( "unable to write ${p}", ("p",m_path) );
+    }
+
+    bool database_answers( soci::session& sql ) {
+        try{
+            int one = 0;
+            sql << "SELECT 1", soci::into(one);
+            return one == 1;
+        } catch(...) {
+            return false;
+        }
+    }
+
+} // namespace
@@ -0,0 +1,272 @@
+// #include "derived_tables.hpp"
+#include <eosio/sql_db_plugin/derived_tables.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+#include <eosio/sql_db_plugin/sql_dialect.hpp>
+
+#include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
+
+namespace eosio {
+
+    void derived_tables::add_account( const string& name ) {
+        m_accounts.insert( name );
+    }
+
+    void derived_tables::set_permission_keys( const string& account, const string& permission, vector<string> public_keys ) {
+        m_permission_keys[ std::make_pair(account, permission) ] = std::move(public_keys);
+    }
+
+    void derived_tables::set_vote( const string& voter, const string& proxy, const string& producers ) {
+        m_votes[voter] = std::make_pair( proxy, producers );
+    }
+
+    void derived_tables::set_proposal( const string& proposer, const string& proposal_name, const string& requested_approvals ) {
+        m_proposals[ std::make_pair(proposer, proposal_name) ] = requested_approvals;
+    }
+
+    void derived_tables::remove_proposal( const string& proposer, const string& proposal_name ) {
+        m_proposals[ std::make_pair(proposer, proposal_name) ] = fc::optional<string>();
+    }
+
+    void derived_tables::set_asset( const asset_row& row ) {
+        m_assets[ std::make_pair(row.symbol, row.contract_owner) ] = row;
+    }
+
+    fc::optional<token_registry::token_info> derived_tables::pending_token( const chain::account_name& contract, const string& symbol ) const {
+        const auto key = std::make_pair( symbol, contract.to_string() );
+        const asset_row* row = nullptr;
+        auto itr = m_assets.find( key );
+        if( itr != m_assets.end() ){
+            row = &itr->second;
+        } else {
+            auto unregistered = m_unregistered.find( key );
+            if( unregistered != m_unregistered.end() ) row = &unregistered->second;
+        }
+        if( !row ) return fc::optional<token_registry::token_info>();
+
+        token_registry::token_info t;
+        t.contract = contract;
+        t.issuer = chain::name(row->issuer);
+        t.symbol = symbol;
+        t.precision = row->precision;
+        return t;
+    }
+
+    // the upsert keeps the row of a re-created token, so its id is the one the registry already has
+    void derived_tables::register_tokens( soci::session& sql, token_registry& tokens ) {
+        for( auto itr = m_unregistered.begin(); itr != m_unregistered.end(); ){
+            const auto& a = itr->second;
+            try{
+                long long id = 0;
+                sql << "SELECT id FROM assets WHERE symbol = :sym and contract_owner = :owner", soci::into(id),
+                        soci::use( a.symbol ),
+                        soci::use( a.contract_owner );
+                if( sql.got_data() ){
+                    token_registry::token_info t;
+                    t.id = id;
+                    t.contract = chain::name(a.contract_owner);
+                    t.issuer = chain::name(a.issuer);
+                    t.symbol = a.symbol;
+                    t.precision = a.precision;
+                    tokens.add( t );
+                }
+                itr = m_unregistered.erase( itr );
+            } catch(soci::soci_error e) {
+                wlog("soci::error: ${e}",("e",e.what()) );
+                ++itr;
+            }
+        }
+    }
+
+    bool derived_tables::flush( soci::session& sql, const std::shared_ptr<token_registry>& tokens, const std::shared_ptr<key_index>& keys ) {
+        if( tokens && !m_unregistered.empty() ) register_tokens( sql, *tokens );
+        if( m_accounts.empty() && m_permission_keys.empty() && m_votes.empty() && m_proposals.empty() && m_assets.empty() ) return true;
+
+        const vector<string> accounts( m_accounts.begin(), m_accounts.end() );
+
+        std::set<key_index::permission_ref> changed_permissions;
+        vector<string> replaced_accounts, replaced_permissions;
+        vector<string> key_accounts, key_permissions, public_keys;
+        for( const auto& p : m_permission_keys ){
+            changed_permissions.emplace( chain::name(p.first.first), chain::name(p.first.second) );
+            replaced_accounts.push_back( p.first.first );
+            replaced_permissions.push_back( p.first.second );
+            for( const auto& key : p.second ){
+                key_accounts.push_back( p.first.first );
+                key_permissions.push_back( p.first.second );
+                public_keys.push_back( key );
+            }
+        }
+
+        vector<string> voters, proxies, producers;
+        for( const auto& v : m_votes ){
+            voters.push_back( v.first );
+            proxies.push_back( v.second.first );
+            producers.push_back( v.second.second );
+        }
+
+        vector<string> proposers, proposal_names, requested;
+        vector<string> removed_proposers, removed_names;
+        for( const auto& p : m_proposals ){
+            if( p.second ){
+                proposers.push_back( p.first.first );
+                proposal_names.push_back( p.first.second );
+                requested.push_back( *p.second );
+            } else {
+                removed_proposers.push_back( p.first.first );
+                removed_names.push_back( p.first.second );
+            }
+        }
+
+        vector<long long> supplies, max_supplies;
+        vector<int> precisions;
+        vector<string> symbols, issuers, owners;
+        for( const auto& a : m_assets ){
+            supplies.push_back( a.second.supply );
+            max_supplies.push_back( a.second.max_supply );
+            precisions.push_back( a.second.precision );
+            symbols.push_back( a.second.symbol );
+            issuers.push_back( a.second.issuer );
+            owners.push_back( a.second.contract_owner );
+        }
+
+        // the rows stay until the transaction commits, a failed flush is retried with them
+        try{
+            static auto& flush_latency = metrics::instance().statement("derived.flush");
+            static auto& account_rows = metrics::instance().rows("accounts");
+            static auto& key_rows = metrics::instance().rows("accounts_keys");
+            static auto& vote_rows = metrics::instance().rows("votes");
+            static auto& proposal_rows = metrics::instance().rows("proposal");
+            static auto& asset_rows = metrics::instance().rows("assets");
+            metrics::scoped_timer t(flush_latency);
+            const auto dialect = sql_dialect::of(sql);
+            soci::transaction tr(sql);
+
+            if( !accounts.empty() ){
+                multi_row_insert( sql, dialect.insert_ignore_into() + "accounts(name)", "(?)", dialect.ignore_conflicts() )
+                    .column( accounts )
+                    .execute();
+            }
+            if( !replaced_accounts.empty() ){
+                sql << "DELETE FROM accounts_keys WHERE account = :ac and permission = :pe",
+                    soci::use(replaced_accounts),
+                    soci::use(replaced_permissions);
+            }
+            if( !public_keys.empty() ){
+                multi_row_insert( sql, dialect.insert_ignore_into() + "accounts_keys(account, public_key, permission)", "(?, ?, ?)", dialect.ignore_conflicts() )
+                    .column( key_accounts )
+                    .column( public_keys )
+                    .column( key_permissions )
+                    .execute();
+            }
+            if( !voters.empty() ){
+                multi_row_insert( sql, "INSERT INTO votes(voter, proxy, producers)", "(?, ?, ?)",
+                        dialect.on_conflict_update("voter", "proxy = " + dialect.excluded("proxy") + ", producers = " + dialect.excluded("producers")) )
+                    .column( voters )
+                    .column( proxies )
+                    .column( producers )
+                    .execute();
+            }
+            if( !removed_proposers.empty() ){
+                sql << "DELETE FROM proposal WHERE proposer = :pro and proposal_name = :proname",
+                    soci::use(removed_proposers),
+                    soci::use(removed_names);
+            }
+            if( !proposers.empty() ){
+                multi_row_insert( sql, "INSERT INTO proposal(proposer, proposal_name, requested_approvals)", "(?, ?, ?)",
+                        dialect.on_conflict_update("proposer, proposal_name", "requested_approvals = " + dialect.excluded("requested_approvals")) )
+                    .column( proposers )
+                    .column( proposal_names )
+                    .column( requested )
+                    .execute();
+            }
+            if( !symbols.empty() ){
+                // an upsert keeps the row id, which the token registry and cursors refer to
+                multi_row_insert( sql, "INSERT INTO assets(supply, max_supply, symbol_precision, symbol, issuer, contract_owner)", "(?, ?, ?, ?, ?, ?)",
+                        dialect.on_conflict_update("symbol, contract_owner",
+                            "supply = " + dialect.excluded("supply") + ", max_supply = " + dialect.excluded("max_supply") +
+                            ", symbol_precision = " + dialect.excluded("symbol_precision") + ", issuer = " + dialect.excluded("issuer")) )
+                    .column( supplies )
+                    .column( max_supplies )
+                    .column( precisions )
+                    .column( symbols )
+                    .column( issuers )
+                    .column( owners )
+                    .execute();
+            }
+            tr.commit();
+            m_accounts.clear();
+            m_permission_keys.clear();
+            m_votes.clear();
+            m_proposals.clear();
+            if( tokens ) m_unregistered.insert( m_assets.begin(), m_assets.end() );
+            m_assets.clear();
+            if( keys ) keys->changed( changed_permissions, public_keys );
+
+            account_rows.add( accounts.size() );
+            key_rows.add( public_keys.size() );
+            vote_rows.add( voters.size() );
+            proposal_rows.add( proposers.size() );
+            asset_rows.add( symbols.size() );
+        } catch(soci::soci_error e) {
+            wlog("soci::error: ${e}",("e",e.what()) );
+            return false;
+        } catch(const std::exception& e) {
+            wlog( "flush derived tables failed. ${e}",("e",e.what()) );
+            return false;
+        } catch(...) {
+            wlog( "flush derived tables failed." );
+            return false;
+        }
+
+        // the tokens of the batch go into the registry now that their assets rows are in; one whose id
+        // cannot be read back stays in m_unregistered for the next flush
+        if( tokens ) register_tokens( sql, *tokens );
+        return true;
+    }
+
+    bool derived_tables::flush_apart( soci::session& sql, const std::shared_ptr<token_registry>& tokens, const std::shared_ptr<key_index>& keys, dead_letter& rejected ) {
+        decltype(m_accounts) accounts;
+        decltype(m_permission_keys) permission_keys;
+        decltype(m_votes) votes;
+        decltype(m_proposals) proposals;
+        decltype(m_assets) assets;
+        accounts.swap( m_accounts );
+        permission_keys.swap( m_permission_keys );
+        votes.swap( m_votes );
+        proposals.swap( m_proposals );
+        assets.swap( m_assets );
+
+        auto flush = [&]{ return this->flush( sql, tokens, keys ); };
+        const bool ok =
+            flush_entries( accounts, m_accounts, sql, flush, [&]( const string& a ){
+                rejected.write( "accounts", fc::mutable_variant_object()( "name", a ) );
+            }) &&
+            flush_entries( permission_keys, m_permission_keys, sql, flush, [&]( const decltype(permission_keys)::value_type& p ){
+                rejected.write( "accounts_keys", fc::mutable_variant_object()
+                    ( "account", p.first.first )( "permission", p.first.second )( "public_keys", p.second ) );
+            }) &&
+            flush_entries( votes, m_votes, sql, flush, [&]( const decltype(votes)::value_type& v ){
+                rejected.write( "votes", fc::mutable_variant_object()
+                    ( "voter", v.first )( "proxy", v.second.first )( "producers", v.second.second ) );
+            }) &&
+            flush_entries( proposals, m_proposals, sql, flush, [&]( const decltype(proposals)::value_type& p ){
+                rejected.write( "proposal", fc::mutable_variant_object()
+                    ( "proposer", p.first.first )( "proposal_name", p.first.second )( "requested_approvals", p.second ) );
+            }) &&
+            flush_entries( assets, m_assets, sql, flush, [&]( const decltype(assets)::value_type& a ){
+                rejected.write( "assets", fc::mutable_variant_object()
+                    ( "supply", int64_t(a.second.supply) )( "max_supply", int64_t(a.second.max_supply) )( "symbol_precision", a.second.precision )
+                    ( "symbol", a.second.symbol )( "issuer", a.second.issuer )( "contract_owner", a.second.contract_owner ) );
+            });
+
+        // what was not tried because the database stopped answering, for the next flush
+        m_accounts.insert( accounts.begin(), accounts.end() );
+        m_permission_keys.insert( permission_keys.begin(), permission_keys.end() );
+        m_votes.insert( votes.begin(), votes.end() );
+        m_proposals.insert( proposals.begin(), proposals.end() );
+        m_assets.insert( assets.begin(), assets.end() );
+        return ok;
+    }
+
+} // namespace
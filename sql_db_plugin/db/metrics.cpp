@@ -0,0 +1,153 @@
+// #include "metrics.hpp"
+#include <eosio/sql_db_plugin/metrics.hpp>
+
+#include <fc/variant_object.hpp>
+
+#include <sstream>
+
+namespace eosio {
+
+    metrics& metrics::instance() {
+        static metrics m;
+        return m;
+    }
+
+    metrics::counter& metrics::rows( const string& table ) {
+        return series( m_rows, table );
+    }
+
+    metrics::histogram& metrics::statement( const string& name ) {
+        return series( m_statements, name );
+    }
+
+    metrics::histogram& metrics::endpoint( const string& name ) {
+        return series( m_endpoints, name );
+    }
+
+    namespace {
+
+        fc::variant histogram_variant( const metrics::histogram& h ) {
+            fc::mutable_variant_object buckets;
+            for( size_t i = 0; i < metrics::histogram::buckets; ++i ){
+                if( h.count(i) == 0 ) continue;
+                // the last bucket takes everything above the one before it
+                buckets( i + 1 < metrics::histogram::buckets ? fc::to_string( metrics::histogram::upper_bound(i) ) : string("+Inf"), h.count(i) );
+            }
+            return fc::mutable_variant_object()
+                ( "count", h.count() )
+                ( "sum_us", h.sum() )
+                ( "buckets_us", buckets );
+        }
+
+        void histogram_text( std::ostringstream& out, const string& name, const string& labels, const metrics::histogram& h ) {
+            const string sep = labels.empty() ? "" : ",";
+            uint64_t cumulative = 0;
+            for( size_t i = 0; i + 1 < metrics::histogram::buckets; ++i ){
+                cumulative += h.count(i);
+                out << name << "_bucket{" << labels << sep << "le=\"" << metrics::histogram::upper_bound(i) / 1e6 << "\"} " << cumulative << "\n";
+            }
+            out << name << "_bucket{" << labels << sep << "le=\"+Inf\"} " << h.count() << "\n";
+            out << name << "_sum" << (labels.empty() ? "" : "{" + labels + "}") << " " << h.sum() / 1e6 << "\n";
+            out << name << "_count" << (labels.empty() ? "" : "{" + labels + "}") << " " << h.count() << "\n";
+        }
+
+    }
+
+    fc::variant metrics::to_variant() {
+        boost::mutex::scoped_lock lock(m_mutex);
+        const auto now = fc::time_point::now();
+        // totals only, a rate is the difference of two scrapes over their interval
+        fc::mutable_variant_object rows;
+        for( const auto& r : m_rows ){
+            rows( r.first, fc::mutable_variant_object()( "total", r.second->value() ) );
+        }
+
+        fc::mutable_variant_object statements;
+        for( const auto& s : m_statements ){
+            statements( s.first, histogram_variant(*s.second) );
+        }
+
+        fc::mutable_variant_object endpoints;
+        for( const auto& e : m_endpoints ){
+            endpoints( e.first, histogram_variant(*e.second) );
+        }
+
+        const auto lookups = abi_cache_hits.value() + abi_cache_misses.value();
+        return fc::mutable_variant_object()
+            ( "uptime_sec", (now - m_started).count() / 1000000 )
+            ( "queues", fc::mutable_variant_object()
+                ( "traces", fc::mutable_variant_object()( "depth", trace_queue_depth.value() )( "bytes", trace_queue_bytes.value() ) )
+                ( "blocks", fc::mutable_variant_object()( "depth", block_queue_depth.value() )( "bytes", block_queue_bytes.value() ) )
+                ( "spill", fc::mutable_variant_object()( "depth", spill_depth.value() )( "bytes", spill_bytes.value() ) ) )
+            ( "enqueue_wait", histogram_variant(enqueue_wait) )
+            ( "traces_dropped", fc::mutable_variant_object()
+                ( "not_executed", traces_not_executed.value() )
+                ( "duplicate", traces_duplicate.value() )
+                ( "undecodable", spill_skipped.value() ) )
+            ( "rows", rows )
+            ( "rows_rejected", rows_rejected.value() )
+            ( "statements", statements )
+            ( "decode", histogram_variant(decode) )
+            ( "decode_path", fc::mutable_variant_object()( "typed", decode_typed.value() )( "abi", decode_abi.value() ) )
+            ( "abi_cache", fc::mutable_variant_object()
+                ( "hits", abi_cache_hits.value() )
+                ( "misses", abi_cache_misses.value() )
+                ( "hit_rate", lookups > 0 ? double(abi_cache_hits.value()) / lookups : 0.0 ) )
+            ( "pool_lease_wait", histogram_variant(pool_lease_wait) )
+            ( "endpoints", endpoints );
+    }
+
+    string metrics::to_prometheus() {
+        boost::mutex::scoped_lock lock(m_mutex);
+        std::ostringstream out;
+
+        out << "# TYPE sql_db_queue_depth gauge\n";
+        out << "sql_db_queue_depth{queue=\"traces\"} " << trace_queue_depth.value() << "\n";
+        out << "sql_db_queue_depth{queue=\"blocks\"} " << block_queue_depth.value() << "\n";
+        out << "sql_db_queue_depth{queue=\"spill\"} " << spill_depth.value() << "\n";
+        out << "# TYPE sql_db_queue_bytes gauge\n";
+        out << "sql_db_queue_bytes{queue=\"traces\"} " << trace_queue_bytes.value() << "\n";
+        out << "sql_db_queue_bytes{queue=\"blocks\"} " << block_queue_bytes.value() << "\n";
+        out << "sql_db_queue_bytes{queue=\"spill\"} " << spill_bytes.value() << "\n";
+
+        out << "# TYPE sql_db_traces_dropped_total counter\n";
+        out << "sql_db_traces_dropped_total{reason=\"not_executed\"} " << traces_not_executed.value() << "\n";
+        out << "sql_db_traces_dropped_total{reason=\"duplicate\"} " << traces_duplicate.value() << "\n";
+        out << "sql_db_traces_dropped_total{reason=\"undecodable\"} " << spill_skipped.value() << "\n";
+
+        out << "# TYPE sql_db_enqueue_wait_seconds histogram\n";
+        histogram_text( out, "sql_db_enqueue_wait_seconds", "", enqueue_wait );
+
+        out << "# TYPE sql_db_rows_total counter\n";
+        for( const auto& r : m_rows ){
+            out << "sql_db_rows_total{table=\"" << r.first << "\"} " << r.second->value() << "\n";
+        }
+        out << "# TYPE sql_db_rows_rejected_total counter\n";
+        out << "sql_db_rows_rejected_total " << rows_rejected.value() << "\n";
+
+        out << "# TYPE sql_db_statement_seconds histogram\n";
+        for( const auto& s : m_statements ){
+            histogram_text( out, "sql_db_statement_seconds", "statement=\"" + s.first + "\"", *s.second );
+        }
+
+        out << "# TYPE sql_db_decode_seconds histogram\n";
+        histogram_text( out, "sql_db_decode_seconds", "", decode );
+        out << "# TYPE sql_db_decode_total counter\n";
+        out << "sql_db_decode_total{path=\"typed\"} " << decode_typed.value() << "\n";
+        out << "sql_db_decode_total{path=\"abi\"} " << decode_abi.value() << "\n";
+
+        out << "# TYPE sql_db_abi_cache_total counter\n";
+        out << "sql_db_abi_cache_total{result=\"hit\"} " << abi_cache_hits.value() << "\n";
+        out << "sql_db_abi_cache_total{result=\"miss\"} " << abi_cache_misses.value() << "\n";
+
+        out << "# TYPE sql_db_pool_lease_wait_seconds histogram\n";
+        histogram_text( out, "sql_db_pool_lease_wait_seconds", "", pool_lease_wait );
+
+        out << "# TYPE sql_db_api_seconds histogram\n";
+        for( const auto& e : m_endpoints ){
+            histogram_text( out, "sql_db_api_seconds", "endpoint=\"" + e.first + "\"", *e.second );
+        }
+        return out.str();
+    }
+
+} // namespace
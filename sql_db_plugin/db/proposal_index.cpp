@@ -0,0 +1,166 @@
+// #include "proposal_index.hpp"
+#include <eosio/sql_db_plugin/proposal_index.hpp>
+
+#include <fc/log/logger.hpp>
+
+namespace eosio {
+
+    void proposal_index::apply( const chain::action& action ) {
+        try {
+            fc::datastream<const char*> ds( action.data.data(), action.data.size() );
+            if( action.name == N(propose) ){
+                msig_propose args;
+                fc::raw::unpack( ds, args );
+                propose( args );
+            } else if( action.name == N(approve) ){
+                msig_approve args;
+                fc::raw::unpack( ds, args );
+                approve( args );
+            } else if( action.name == N(unapprove) ){
+                msig_approve args;
+                fc::raw::unpack( ds, args );
+                unapprove( args );
+            } else if( action.name == N(exec) || action.name == N(cancel) ){
+                msig_close args;
+                fc::raw::unpack( ds, args );
+                remove( key_type(args.proposer, args.proposal_name) );
+            }
+        } catch(fc::exception& e) {
+            wlog("proposal index: unable to apply ${a}: ${e}",("a",action.name)("e",e.what()));
+        } catch(std::exception& e) {
+            wlog("proposal index: unable to apply ${a}: ${e}",("a",action.name)("e",e.what()));
+        }
+    }
+
+    void proposal_index::add( const chain::account_name& proposer, const msig_approvals_row& row, chain::transaction trx ) {
+        auto e = std::make_shared<entry>();
+        e->proposer = proposer;
+        e->proposal_name = row.proposal_name;
+        e->trx = std::move(trx);
+        e->requested_approvals = row.requested_approvals;
+        e->provided_approvals = row.provided_approvals;
+
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        publish( key_type(proposer, row.proposal_name), e );
+    }
+
+    void proposal_index::clear() {
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        m_proposals.clear();
+        m_by_approver.clear();
+    }
+
+    void proposal_index::propose( const msig_propose& args ) {
+        auto e = std::make_shared<entry>();
+        e->proposer = args.proposer;
+        e->proposal_name = args.proposal_name;
+        e->trx = args.trx;
+        e->requested_approvals = args.requested;
+
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        publish( key_type(args.proposer, args.proposal_name), e );
+    }
+
+    void proposal_index::approve( const msig_approve& args ) {
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        const auto key = key_type(args.proposer, args.proposal_name);
+        auto itr = m_proposals.find(key);
+        if( itr == m_proposals.end() ) return;
+
+        auto e = std::make_shared<entry>(*itr->second);
+        auto req = std::find(e->requested_approvals.begin(), e->requested_approvals.end(), args.level);
+        if( req == e->requested_approvals.end() ) return;
+
+        e->requested_approvals.erase(req);
+        e->provided_approvals.push_back(args.level);
+        e->status.reset();
+        publish( key, e );
+    }
+
+    void proposal_index::unapprove( const msig_approve& args ) {
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        const auto key = key_type(args.proposer, args.proposal_name);
+        auto itr = m_proposals.find(key);
+        if( itr == m_proposals.end() ) return;
+
+        auto e = std::make_shared<entry>(*itr->second);
+        auto prov = std::find(e->provided_approvals.begin(), e->provided_approvals.end(), args.level);
+        if( prov == e->provided_approvals.end() ) return;
+
+        e->provided_approvals.erase(prov);
+        e->requested_approvals.push_back(args.level);
+        e->status.reset();
+        publish( key, e );
+    }
+
+    void proposal_index::remove( const key_type& key ) {
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        publish( key, nullptr );
+    }
+
+    // caller holds the unique lock; a null entry removes the proposal
+    void proposal_index::publish( const key_type& key, const std::shared_ptr<entry>& e ) {
+        auto itr = m_proposals.find(key);
+        if( itr != m_proposals.end() ){
+            for( const auto& level : itr->second->requested_approvals ){
+                auto approver = m_by_approver.find(level.actor);
+                if( approver == m_by_approver.end() ) continue;
+                approver->second.erase(key);
+                if( approver->second.empty() ) m_by_approver.erase(approver);
+            }
+        }
+
+        if( !e ){
+            if( itr != m_proposals.end() ) m_proposals.erase(itr);
+            return;
+        }
+
+        for( const auto& level : e->requested_approvals ){
+            m_by_approver[level.actor].insert(key);
+        }
+        m_proposals[key] = e;
+    }
+
+    proposal_index::entry_ptr proposal_index::get( const chain::account_name& proposer, const chain::name& proposal_name ) const {
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        auto itr = m_proposals.find( key_type(proposer, proposal_name) );
+        if( itr == m_proposals.end() ) return entry_ptr();
+        return itr->second;
+    }
+
+    vector<proposal_index::entry_ptr> proposal_index::get_pending( const chain::account_name& approver ) const {
+        vector<entry_ptr> result;
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        auto keys = m_by_approver.find(approver);
+        if( keys == m_by_approver.end() ) return result;
+
+        result.reserve(keys->second.size());
+        for( const auto& key : keys->second ){
+            auto itr = m_proposals.find(key);
+            if( itr != m_proposals.end() ) result.push_back(itr->second);
+        }
+        return result;
+    }
+
+    vector<proposal_index::entry_ptr> proposal_index::get_by_proposer( const chain::account_name& proposer ) const {
+        vector<entry_ptr> result;
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        for( auto itr = m_proposals.lower_bound( key_type(proposer, chain::name()) );
+             itr != m_proposals.end() && itr->first.first == proposer; ++itr ){
+            result.push_back(itr->second);
+        }
+        return result;
+    }
+
+    void proposal_index::set_rendered( const entry_ptr& old, std::shared_ptr<const string> json, uint8_t status ) {
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        auto itr = m_proposals.find( key_type(old->proposer, old->proposal_name) );
+        if( itr == m_proposals.end() || itr->second != old ) return;
+
+        auto e = std::make_shared<entry>(*old);
+        e->transaction_json = std::move(json);
+        e->status = status;
+        itr->second = e;
+    }
+
+} // namespace
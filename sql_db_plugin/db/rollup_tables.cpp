@@ -0,0 +1,165 @@
+// #include "rollup_tables.hpp"
+#include <eosio/sql_db_plugin/rollup_tables.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+#include <eosio/sql_db_plugin/sql_dialect.hpp>
+
+#include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
+
+namespace eosio {
+
+    void rollup_tables::add_action( const chain::account_name& contract, const chain::action_name& action, chain::block_timestamp_type time ) {
+        if( m_skip ) return;
+        ++m_actions[ std::make_tuple(contract.to_string(), action.to_string(), hour_of(time)) ];
+    }
+
+    void rollup_tables::add_block( const chain::account_name& producer, chain::block_timestamp_type time ) {
+        if( m_skip ) return;
+        ++m_producers[ std::make_pair(producer.to_string(), hour_of(time)) ].first;
+    }
+
+    void rollup_tables::add_transaction( const chain::account_name& producer, chain::block_timestamp_type time ) {
+        if( m_skip ) return;
+        ++m_producers[ std::make_pair(producer.to_string(), hour_of(time)) ].second;
+    }
+
+    void rollup_tables::add_transfer( const chain::account_name& contract, const chain::asset& quantity, chain::block_timestamp_type time ) {
+        if( m_skip ) return;
+        auto& t = m_transfers[ std::make_tuple(contract.to_string(), quantity.get_symbol().name(), hour_of(time)) ];
+        ++t.transfers;
+        t.volume += quantity.get_amount();
+        t.precision = quantity.decimals();
+    }
+
+    bool rollup_tables::flush( soci::session& sql ) {
+        if( m_actions.empty() && m_producers.empty() && m_transfers.empty() && !m_status.behind() ) return true;
+
+        std::vector<string> contracts, actions;
+        std::vector<long long> action_hours, action_counts;
+        for( const auto& a : m_actions ){
+            contracts.push_back( std::get<0>(a.first) );
+            actions.push_back( std::get<1>(a.first) );
+            action_hours.push_back( std::get<2>(a.first) );
+            action_counts.push_back( a.second );
+        }
+
+        std::vector<string> producers;
+        std::vector<long long> producer_hours, blocks, transactions;
+        for( const auto& p : m_producers ){
+            producers.push_back( p.first.first );
+            producer_hours.push_back( p.first.second );
+            blocks.push_back( p.second.first );
+            transactions.push_back( p.second.second );
+        }
+
+        std::vector<string> token_contracts, symbols;
+        std::vector<long long> transfer_hours, transfers, volumes;
+        std::vector<int> precisions;
+        for( const auto& t : m_transfers ){
+            token_contracts.push_back( std::get<0>(t.first) );
+            symbols.push_back( std::get<1>(t.first) );
+            transfer_hours.push_back( std::get<2>(t.first) );
+            transfers.push_back( t.second.transfers );
+            volumes.push_back( t.second.volume );
+            precisions.push_back( t.second.precision );
+        }
+
+        // the counts stay until the transaction commits, a failed flush is retried with them
+        try{
+            static auto& flush_latency = metrics::instance().statement("rollups.flush");
+            static auto& rollup_rows = metrics::instance().rows("rollups");
+            metrics::scoped_timer t(flush_latency);
+            const auto dialect = sql_dialect::of(sql);
+            auto add = [&]( const string& table, const string& column ){
+                return column + " = " + dialect.current(table, column) + " + " + dialect.excluded(column);
+            };
+            soci::transaction tr(sql);
+
+            if( !contracts.empty() ){
+                multi_row_insert( sql, "INSERT INTO action_stats_hourly(contract, action, hour, actions)", "(?, ?, " + dialect.from_unixtime("?") + ", ?)",
+                        dialect.on_conflict_update("contract, action, hour", add("action_stats_hourly", "actions")) )
+                    .column( contracts )
+                    .column( actions )
+                    .column( action_hours )
+                    .column( action_counts )
+                    .execute();
+            }
+            if( !producers.empty() ){
+                multi_row_insert( sql, "INSERT INTO producer_stats_hourly(producer, hour, blocks, transactions)", "(?, " + dialect.from_unixtime("?") + ", ?, ?)",
+                        dialect.on_conflict_update("producer, hour", add("producer_stats_hourly", "blocks") + ", " + add("producer_stats_hourly", "transactions")) )
+                    .column( producers )
+                    .column( producer_hours )
+                    .column( blocks )
+                    .column( transactions )
+                    .execute();
+            }
+            if( !token_contracts.empty() ){
+                multi_row_insert( sql, "INSERT INTO transfer_stats_hourly(contract, symbol, hour, transfers, volume, symbol_precision)",
+                        "(?, ?, " + dialect.from_unixtime("?") + ", ?, ?, ?)",
+                        dialect.on_conflict_update("contract, symbol, hour", add("transfer_stats_hourly", "transfers") + ", " + add("transfer_stats_hourly", "volume") +
+                            ", symbol_precision = " + dialect.excluded("symbol_precision")) )
+                    .column( token_contracts )
+                    .column( symbols )
+                    .column( transfer_hours )
+                    .column( transfers )
+                    .column( volumes )
+                    .column( precisions )
+                    .execute();
+            }
+            m_status.write( sql, dialect );
+            tr.commit();
+            m_status.committed();
+            m_actions.clear();
+            m_producers.clear();
+            m_transfers.clear();
+            rollup_rows.add( contracts.size() + producers.size() + token_contracts.size() );
+        } catch(soci::soci_error e) {
+            wlog("soci::error: ${e}",("e",e.what()) );
+            return false;
+        } catch(const std::exception& e) {
+            wlog( "flush rollups failed. ${e}",("e",e.what()) );
+            return false;
+        } catch(...) {
+            wlog( "flush rollups failed." );
+            return false;
+        }
+        return true;
+    }
+
+    bool rollup_tables::flush_apart( soci::session& sql, dead_letter& rejected ) {
+        decltype(m_actions) actions;
+        decltype(m_producers) producers;
+        decltype(m_transfers) transfers;
+        actions.swap( m_actions );
+        producers.swap( m_producers );
+        transfers.swap( m_transfers );
+
+        auto flush = [&]{ return this->flush( sql ); };
+        m_status.hold( true );
+        const bool ok =
+            flush_entries( actions, m_actions, sql, flush, [&]( const decltype(actions)::value_type& a ){
+                rejected.write( "action_stats_hourly", fc::mutable_variant_object()
+                    ( "contract", std::get<0>(a.first) )( "action", std::get<1>(a.first) )( "hour", int64_t(std::get<2>(a.first)) )
+                    ( "actions", int64_t(a.second) ) );
+            }) &&
+            flush_entries( producers, m_producers, sql, flush, [&]( const decltype(producers)::value_type& p ){
+                rejected.write( "producer_stats_hourly", fc::mutable_variant_object()
+                    ( "producer", p.first.first )( "hour", int64_t(p.first.second) )
+                    ( "blocks", int64_t(p.second.first) )( "transactions", int64_t(p.second.second) ) );
+            }) &&
+            flush_entries( transfers, m_transfers, sql, flush, [&]( const decltype(transfers)::value_type& t ){
+                rejected.write( "transfer_stats_hourly", fc::mutable_variant_object()
+                    ( "contract", std::get<0>(t.first) )( "symbol", std::get<1>(t.first) )( "hour", int64_t(std::get<2>(t.first)) )
+                    ( "transfers", int64_t(t.second.transfers) )( "volume", int64_t(t.second.volume) )( "symbol_precision", t.second.precision ) );
+            });
+        m_status.hold( false );
+
+        // what was not tried because the database stopped answering, for the next flush
+        m_actions.insert( actions.begin(), actions.end() );
+        m_producers.insert( producers.begin(), producers.end() );
+        m_transfers.insert( transfers.begin(), transfers.end() );
+        // the watermark, now that every count is written or rejected
+        return ok && flush( sql );
+    }
+
+} // namespace
@@ -0,0 +1,211 @@
+// #include "spill_journal.hpp"
+#include <eosio/sql_db_plugin/spill_journal.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <fstream>
+#include <set>
+
+namespace eosio {
+
+    static string create_dir( const string& dir ) {
+        boost::filesystem::create_directories( dir );
+        return dir;
+    }
+
+    // the numbers n of the dir/spill.<n>.traces segments
+    static std::set<uint64_t> list_segments( const string& dir ) {
+        std::set<uint64_t> segments;
+        for( const auto& entry : boost::filesystem::directory_iterator( dir ) ){
+            const auto name = entry.path().filename().string();
+            const string prefix = "spill.", suffix = ".traces";
+            if( name.size() <= prefix.size() + suffix.size() || name.compare( 0, prefix.size(), prefix ) != 0 ||
+                name.compare( name.size() - suffix.size(), suffix.size(), suffix ) != 0 ) continue;
+            const auto number = name.substr( prefix.size(), name.size() - prefix.size() - suffix.size() );
+            if( number.find_first_not_of( "0123456789" ) != string::npos ) continue;
+            segments.insert( std::stoull( number ) );
+        }
+        return segments;
+    }
+
+    spill_journal::spill_journal( const string& dir, uint64_t segment_size )
+        : m_dir( create_dir(dir) ),
+          m_checkpoint_path( (boost::filesystem::path(dir) / "spill.checkpoint").string() ),
+          m_segment_size( segment_size ) {
+        // a journal of a single spill.traces, from before segments, is segment 0
+        const auto legacy = boost::filesystem::path(dir) / "spill.traces";
+        auto segments = list_segments( dir );
+        if( segments.empty() && boost::filesystem::exists( legacy ) ){
+            boost::filesystem::rename( legacy, segment_path(0) );
+            segments.insert( 0 );
+        }
+
+        // "segment offset", or only the offset in segment 0 from before segments
+        m_committed = trace_file_reader::first();
+        if( boost::filesystem::exists( m_checkpoint_path ) ){
+            std::ifstream in( m_checkpoint_path );
+            uint64_t first = 0, second = 0;
+            in >> first;
+            if( in >> second ){
+                m_committed_segment = first;
+                m_committed = std::max<uint64_t>( m_committed, second );
+            } else {
+                m_committed = std::max<uint64_t>( m_committed, first );
+            }
+        }
+
+        // segments before the checkpoint were committed, a crash may have kept them from being deleted
+        while( !segments.empty() && *segments.begin() < m_committed_segment ){
+            boost::filesystem::remove( segment_path( *segments.begin() ) );
+            segments.erase( segments.begin() );
+        }
+        if( segments.empty() ){
+            m_first = m_last = m_committed_segment;
+        } else {
+            m_first = *segments.begin();
+            m_last = *segments.rbegin();
+        }
+        if( m_committed_segment < m_first ){
+            m_committed_segment = m_first;
+            m_committed = trace_file_reader::first();
+        }
+        m_writer = std::make_unique<trace_file_writer>( segment_path(m_last) );
+        // a crash between emptying the journal and writing the checkpoint leaves it past the end
+        if( m_committed_segment == m_last && m_committed > m_writer->size() ) m_committed = m_writer->size();
+        m_read_segment = m_committed_segment;
+        m_read_offset = m_committed;
+
+        uint64_t bytes = 0;
+        m_writer->flush();
+        for( uint64_t segment = m_committed_segment; segment <= m_last; ++segment ){
+            trace_file_reader reader( segment_path(segment) );
+            trace_file::record r;
+            for( uint64_t offset = segment == m_committed_segment ? m_committed : trace_file_reader::first();
+                 reader.read( offset, r ); offset = trace_file_reader::next( offset, r ) ){
+                ++m_unread;
+                bytes += trace_file_reader::next( offset, r ) - offset;
+            }
+        }
+        if( m_unread > 0 ){
+            ilog("spill journal ${d} has ${n} traces to write in ${s} segments",("d",dir)("n",m_unread)("s",m_last - m_committed_segment + 1));
+        }
+        metrics::instance().spill_depth.add( m_unread );
+        metrics::instance().spill_bytes.add( bytes );
+    }
+
+    string spill_journal::segment_path( uint64_t segment ) const {
+        return (boost::filesystem::path(m_dir) / ("spill." + std::to_string(segment) + ".traces")).string();
+    }
+
+    void spill_journal::append( const chain::transaction_trace& trace ) {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if( m_writer->size() >= m_segment_size ){
+            m_writer.reset();
+            m_writer = std::make_unique<trace_file_writer>( segment_path(++m_last) );
+        }
+        const auto before = m_writer->size();
+        m_writer->append( trace );
+        ++m_unread;
+        metrics::instance().spill_depth.add( 1 );
+        metrics::instance().spill_bytes.add( m_writer->size() - before );
+    }
+
+    size_t spill_journal::unread() const {
+        boost::mutex::scoped_lock lock(m_mutex);
+        return m_unread;
+    }
+
+    // under m_mutex: maps the segment being read, moving on to the next one when a finished segment
+    // is read to its end. The mapping only covers the file as it was when mapped; remap to see later appends
+    void spill_journal::open_reader() {
+        while( !m_reader || m_reader->end() <= m_read_offset ){
+            const bool finished = m_read_segment < m_last;
+            if( !finished ) m_writer->flush();
+            m_reader.reset();
+            m_reader = std::make_unique<trace_file_reader>( segment_path(m_read_segment) );
+            if( m_reader->end() > m_read_offset || !finished ) return;
+            ++m_read_segment;
+            m_read_offset = trace_file_reader::first();
+            m_reader.reset();
+        }
+    }
+
+    vector<chain::transaction_trace_ptr> spill_journal::read( size_t max ) {
+        vector<chain::transaction_trace_ptr> traces;
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            if( m_unread == 0 ) return traces;
+            open_reader();
+        }
+
+        // the mapped records are never rewritten while unread ones remain, so decode them unlocked
+        trace_file::record r;
+        uint64_t offset = m_read_offset;
+        size_t records = 0;
+        while( records < max && m_reader->read( offset, r ) ){
+            // a record that does not decode is skipped, retrying it would stall the writer for good
+            try{
+                traces.push_back( r.unpack() );
+            } catch(fc::exception& e) {
+                wlog( "skipping undecodable trace at ${o} in ${p}: ${e}",("o",offset)("p",segment_path(m_read_segment))("e",e.to_string()) );
+                metrics::instance().spill_skipped.add();
+            }
+            offset = trace_file_reader::next( offset, r );
+            ++records;
+        }
+
+        boost::mutex::scoped_lock lock(m_mutex);
+        if( records == 0 ){
+            // nothing complete past the read offset, the count is off; waiting on it would spin forever
+            wlog( "spill journal ${d} counts ${n} unread traces but has none",("d",m_dir)("n",m_unread) );
+            metrics::instance().spill_depth.add( -int64_t(m_unread) );
+            m_unread = 0;
+            return traces;
+        }
+        m_uncommitted_bytes += offset - m_read_offset;
+        m_read_offset = offset;
+        m_unread -= std::min( records, m_unread );
+        m_uncommitted += records;
+        return traces;
+    }
+
+    void spill_journal::commit() {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if( m_uncommitted == 0 ) return;
+        metrics::instance().spill_depth.add( -int64_t(m_uncommitted) );
+        metrics::instance().spill_bytes.add( -int64_t(m_uncommitted_bytes) );
+        m_uncommitted = 0;
+        m_uncommitted_bytes = 0;
+        m_committed_segment = m_read_segment;
+        m_committed = m_read_offset;
+
+        if( m_unread == 0 && m_read_segment == m_last ){
+            m_reader.reset();
+            m_writer->reset();
+            m_committed = m_read_offset = m_writer->size();
+        }
+        // the checkpoint first, a crash then leaves segments the next start deletes rather than a
+        // checkpoint into a deleted one
+        write_checkpoint();
+        for( ; m_first < m_committed_segment; ++m_first ){
+            boost::system::error_code ec;
+            boost::filesystem::remove( segment_path(m_first), ec );
+            if( ec ) wlog( "unable to delete ${p}: ${e}",("p",segment_path(m_first))("e",ec.message()) );
+        }
+    }
+
+    // written beside and renamed over, so a crash leaves either the old or the new checkpoint
+    void spill_journal::write_checkpoint() {
+        const auto tmp = m_checkpoint_path + ".tmp";
+        {
+            std::ofstream out( tmp, std::ios::trunc );
+            out << m_committed_segment << " " << m_committed;
+            FC_ASSERT( out.good(), "unable to write ${p}", ("p",tmp) );
+        }
+        boost::filesystem::rename( tmp, m_checkpoint_path );
+    }
+
+} // namespace
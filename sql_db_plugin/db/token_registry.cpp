@@ -0,0 +1,89 @@
+// #include "token_registry.hpp"
+#include <eosio/sql_db_plugin/token_registry.hpp>
+
+namespace eosio {
+
+    // a re-created token replaces the previous entry, it gets a new id from the assets table
+    void token_registry::add( const token_info& t ) {
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        const auto key = key_type(t.contract, t.symbol);
+        auto itr = m_by_symbol.find(key);
+        if( itr != m_by_symbol.end() ){
+            m_tokens.erase(itr->second);
+        }
+        m_by_symbol[key] = t.id;
+        m_tokens[t.id] = t;
+    }
+
+    size_t token_registry::size() const {
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        return m_tokens.size();
+    }
+
+    vector<token_registry::token_info> token_registry::list() const {
+        vector<token_info> result;
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        result.reserve(m_tokens.size());
+        for( const auto& t : m_tokens ){
+            result.push_back(t.second);
+        }
+        return result;
+    }
+
+    vector<token_registry::token_info> token_registry::page( size_t offset, size_t limit ) const {
+        vector<token_info> result;
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        if( offset >= m_tokens.size() ) return result;
+
+        auto itr = m_tokens.begin();
+        std::advance(itr, offset);
+        for( ; itr != m_tokens.end() && result.size() < limit; ++itr ){
+            result.push_back(itr->second);
+        }
+        return result;
+    }
+
+    vector<token_registry::token_info> token_registry::page_after( int64_t id, size_t limit ) const {
+        vector<token_info> result;
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        for( auto itr = m_tokens.upper_bound(id); itr != m_tokens.end() && result.size() < limit; ++itr ){
+            result.push_back(itr->second);
+        }
+        return result;
+    }
+
+    vector<token_registry::token_info> token_registry::find_contract( const chain::account_name& contract ) const {
+        vector<token_info> result;
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        for( auto itr = m_by_symbol.lower_bound( key_type(contract, string()) );
+             itr != m_by_symbol.end() && itr->first.first == contract; ++itr ){
+            result.push_back( m_tokens.at(itr->second) );
+        }
+        return result;
+    }
+
+    fc::optional<token_registry::token_info> token_registry::find( const chain::account_name& contract, const string& symbol ) const {
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        auto itr = m_by_symbol.find( key_type(contract, symbol) );
+        if( itr == m_by_symbol.end() ) return fc::optional<token_info>();
+        return m_tokens.at(itr->second);
+    }
+
+    fc::optional<bool> token_registry::has_accounts_table( const chain::account_name& contract ) const {
+        boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+        auto itr = m_accounts_table.find(contract);
+        if( itr == m_accounts_table.end() ) return fc::optional<bool>();
+        return itr->second;
+    }
+
+    void token_registry::set_has_accounts_table( const chain::account_name& contract, bool has ) {
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        m_accounts_table[contract] = has;
+    }
+
+    void token_registry::invalidate_abi( const chain::account_name& contract ) {
+        boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+        m_accounts_table.erase(contract);
+    }
+
+} // namespace
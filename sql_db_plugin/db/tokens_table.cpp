@@ -0,0 +1,145 @@
+// #include "tokens_table.hpp"
+#include <eosio/sql_db_plugin/tokens_table.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+#include <eosio/sql_db_plugin/sql_dialect.hpp>
+
+#include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
+
+namespace eosio {
+
+    void tokens_table::add_holder( std::shared_ptr<soci::session> m_session, string account, string contract ) {
+        try{
+            static auto& holder_rows = metrics::instance().rows("account_tokens");
+            *m_session << sql_dialect::of(*m_session).insert_ignore("account_tokens(account, contract) VALUES (:ac, :co)"),
+                soci::use(account),
+                soci::use(contract);
+            holder_rows.add();
+        } catch(soci::soci_error e) {
+            wlog("soci::error: ${e}",("e",e.what()) );
+        } catch(const std::exception& e) {
+            wlog( "add token holder failed. ${a} ${c} ${e}",("a",account)("c",contract)("e",e.what()) );
+        } catch(...) {
+            wlog( "add token holder failed. ${a} ${c}",("a",account)("c",contract) );
+        }
+    }
+
+    vector<string> tokens_table::get_holder_contracts( std::shared_ptr<soci::session> m_session, string account ) {
+        vector<string> contracts;
+        soci::rowset<string> rs = ( m_session->prepare << "SELECT contract FROM account_tokens WHERE account = :ac",
+            soci::use(account) );
+        for( const auto& contract : rs ){
+            contracts.push_back(contract);
+        }
+        return contracts;
+    }
+
+    void tokens_table::add_balance( const chain::account_name& account, const chain::account_name& contract, const chain::asset& delta ) {
+        if( m_skip ) return;
+        auto& d = m_balance_deltas[ std::make_tuple(account.to_string(), contract.to_string(), delta.get_symbol().name()) ];
+        d.first += delta.get_amount();
+        d.second = delta.decimals();
+    }
+
+    void tokens_table::add_supply( const chain::account_name& contract, const chain::asset& delta ) {
+        if( m_skip ) return;
+        m_supply_deltas[ std::make_pair(contract.to_string(), delta.get_symbol().name()) ] += delta.get_amount();
+    }
+
+    bool tokens_table::flush( std::shared_ptr<soci::session> m_session ) {
+        if( m_balance_deltas.empty() && m_supply_deltas.empty() && !m_status.behind() ) return true;
+
+        vector<string> accounts, contracts, symbols;
+        vector<long long> amounts;
+        vector<int> precisions;
+        for( const auto& d : m_balance_deltas ){
+            if( d.second.first == 0 ) continue;
+            accounts.push_back( std::get<0>(d.first) );
+            contracts.push_back( std::get<1>(d.first) );
+            symbols.push_back( std::get<2>(d.first) );
+            amounts.push_back( d.second.first );
+            precisions.push_back( d.second.second );
+        }
+
+        vector<string> supply_contracts, supply_symbols;
+        vector<long long> supply_amounts;
+        for( const auto& d : m_supply_deltas ){
+            if( d.second == 0 ) continue;
+            supply_contracts.push_back( d.first.first );
+            supply_symbols.push_back( d.first.second );
+            supply_amounts.push_back( d.second );
+        }
+
+        // the deltas stay until the transaction commits, a failed flush is retried with them
+        try{
+            static auto& flush_latency = metrics::instance().statement("tokens.flush");
+            static auto& token_rows = metrics::instance().rows("tokens");
+            static auto& asset_rows = metrics::instance().rows("assets");
+            metrics::scoped_timer t(flush_latency);
+            const auto dialect = sql_dialect::of(*m_session);
+            soci::transaction tr(*m_session);
+            if( !accounts.empty() ){
+                *m_session << dialect.upsert("tokens(account, symbol, balance, symbol_precision, contract_owner) VALUES (:ac, :sy, :ba, :pr, :co)",
+                                  "account, symbol, contract_owner",
+                                  "balance = " + dialect.current("tokens", "balance") + " + " + dialect.excluded("balance") +
+                                  ", symbol_precision = " + dialect.excluded("symbol_precision")),
+                    soci::use(accounts),
+                    soci::use(symbols),
+                    soci::use(amounts),
+                    soci::use(precisions),
+                    soci::use(contracts);
+            }
+            if( !supply_contracts.empty() ){
+                *m_session << "UPDATE assets SET supply = supply + :am WHERE contract_owner = :co and symbol = :sy",
+                    soci::use(supply_amounts),
+                    soci::use(supply_contracts),
+                    soci::use(supply_symbols);
+            }
+            m_status.write( *m_session, dialect );
+            tr.commit();
+            m_status.committed();
+            m_balance_deltas.clear();
+            m_supply_deltas.clear();
+            token_rows.add( accounts.size() );
+            asset_rows.add( supply_contracts.size() );
+        } catch(soci::soci_error e) {
+            wlog("soci::error: ${e}",("e",e.what()) );
+            return false;
+        } catch(const std::exception& e) {
+            wlog( "flush token balances failed. ${e}",("e",e.what()) );
+            return false;
+        } catch(...) {
+            wlog( "flush token balances failed." );
+            return false;
+        }
+        return true;
+    }
+
+    bool tokens_table::flush_apart( std::shared_ptr<soci::session> m_session, dead_letter& rejected ) {
+        decltype(m_balance_deltas) balances;
+        decltype(m_supply_deltas) supplies;
+        balances.swap( m_balance_deltas );
+        supplies.swap( m_supply_deltas );
+
+        auto flush = [&]{ return this->flush( m_session ); };
+        m_status.hold( true );
+        const bool ok =
+            flush_entries( balances, m_balance_deltas, *m_session, flush, [&]( const decltype(balances)::value_type& b ){
+                rejected.write( "tokens", fc::mutable_variant_object()
+                    ( "account", std::get<0>(b.first) )( "contract_owner", std::get<1>(b.first) )( "symbol", std::get<2>(b.first) )
+                    ( "balance_delta", b.second.first )( "symbol_precision", b.second.second ) );
+            }) &&
+            flush_entries( supplies, m_supply_deltas, *m_session, flush, [&]( const decltype(supplies)::value_type& d ){
+                rejected.write( "assets", fc::mutable_variant_object()
+                    ( "contract_owner", d.first.first )( "symbol", d.first.second )( "supply_delta", d.second ) );
+            });
+        m_status.hold( false );
+
+        // what was not tried because the database stopped answering, for the next flush
+        m_balance_deltas.insert( balances.begin(), balances.end() );
+        m_supply_deltas.insert( supplies.begin(), supplies.end() );
+        // the watermark, now that every delta is written or rejected
+        return ok && flush( m_session );
+    }
+
+} // namespace
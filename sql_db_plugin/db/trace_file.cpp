@@ -0,0 +1,131 @@
+// #include "trace_file.hpp"
+#include <eosio/sql_db_plugin/trace_file.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw.hpp>
+
+#include <cstring>
+#include <unistd.h>
+
+namespace eosio {
+
+    captured_trace::captured_trace( const chain::transaction_trace& t )
+        : id(t.id), block_num(t.block_num), block_time(t.block_time), receipt(t.receipt), elapsed(t.elapsed),
+          net_usage(t.net_usage), scheduled(t.scheduled), action_traces(t.action_traces) {
+        if( t.except ) except = t.except->to_string();
+    }
+
+    chain::transaction_trace_ptr captured_trace::to_trace() const {
+        auto t = std::make_shared<chain::transaction_trace>();
+        t->id = id;
+        t->block_num = block_num;
+        t->block_time = block_time;
+        t->receipt = receipt;
+        t->elapsed = elapsed;
+        t->net_usage = net_usage;
+        t->scheduled = scheduled;
+        t->action_traces = action_traces;
+        if( except ) t->except = fc::exception( fc::log_message( FC_LOG_CONTEXT(error), *except ) );
+        return t;
+    }
+
+    chain::transaction_trace_ptr trace_file::record::unpack() const {
+        fc::datastream<const char*> ds( data, size );
+        captured_trace t;
+        fc::raw::unpack( ds, t );
+        return t.to_trace();
+    }
+
+    static void write_header( FILE* f ) {
+        char header[trace_file::header_size] = {};
+        memcpy( header, trace_file::magic, sizeof(trace_file::magic) );
+        memcpy( header + 8, &trace_file::version, sizeof(uint32_t) );
+        FC_ASSERT( fwrite( header, 1, sizeof(header), f ) == sizeof(header), "unable to write trace file header" );
+    }
+
+    trace_file_writer::trace_file_writer( const string& path ) : m_path(path) {
+        boost::system::error_code ec;
+        const auto existing = boost::filesystem::file_size( path, ec );
+        if( ec || existing == 0 ){
+            m_file = fopen( path.c_str(), "wb" );
+            FC_ASSERT( m_file, "unable to create trace file ${p}", ("p",path) );
+            write_header( m_file );
+            m_size = trace_file::header_size;
+            return;
+        }
+
+        // continue after the last complete record, dropping a partial one left by a crash
+        m_size = trace_file_reader( path ).end();
+        FC_ASSERT( truncate( path.c_str(), m_size ) == 0, "unable to truncate trace file ${p}", ("p",path) );
+        m_file = fopen( path.c_str(), "ab" );
+        FC_ASSERT( m_file, "unable to open trace file ${p}", ("p",path) );
+    }
+
+    trace_file_writer::~trace_file_writer() {
+        if( m_file ) fclose( m_file );
+    }
+
+    void trace_file_writer::append( const chain::transaction_trace& trace ) {
+        const captured_trace t( trace );
+        const uint32_t size = fc::raw::pack_size( t );
+        m_buffer.resize( trace_file::record_header_size + size );
+
+        const int64_t block_time = trace.block_time.operator fc::time_point().time_since_epoch().count();
+        memcpy( m_buffer.data(), &size, sizeof(uint32_t) );
+        memcpy( m_buffer.data() + 4, &trace.block_num, sizeof(uint32_t) );
+        memcpy( m_buffer.data() + 8, &block_time, sizeof(int64_t) );
+        fc::datastream<char*> ds( m_buffer.data() + trace_file::record_header_size, size );
+        fc::raw::pack( ds, t );
+
+        FC_ASSERT( fwrite( m_buffer.data(), 1, m_buffer.size(), m_file ) == m_buffer.size(), "unable to write ${p}", ("p",m_path) );
+        m_size += m_buffer.size();
+    }
+
+    void trace_file_writer::flush() {
+        fflush( m_file );
+    }
+
+    void trace_file_writer::reset() {
+        fflush( m_file );
+        FC_ASSERT( ftruncate( fileno(m_file), trace_file::header_size ) == 0, "unable to truncate ${p}", ("p",m_path) );
+        // a file opened "wb" keeps its offset past the truncation, the next record would leave a hole
+        FC_ASSERT( fseek( m_file, trace_file::header_size, SEEK_SET ) == 0, "unable to seek ${p}", ("p",m_path) );
+        m_size = trace_file::header_size;
+    }
+
+    trace_file_reader::trace_file_reader( const string& path )
+        : m_mapping( path.c_str(), boost::interprocess::read_only ),
+          m_region( m_mapping, boost::interprocess::read_only ) {
+        m_data = static_cast<const char*>( m_region.get_address() );
+        m_size = m_region.get_size();
+
+        uint32_t file_version = 0;
+        FC_ASSERT( m_size >= trace_file::header_size && memcmp( m_data, trace_file::magic, sizeof(trace_file::magic) ) == 0,
+                   "${p} is not a trace file", ("p",path) );
+        memcpy( &file_version, m_data + 8, sizeof(uint32_t) );
+        FC_ASSERT( file_version == trace_file::version, "${p} has unsupported trace file version ${v}", ("p",path)("v",file_version) );
+
+        m_end = first();
+        trace_file::record r;
+        while( read( m_end, r ) ){
+            m_end = next( m_end, r );
+            ++m_count;
+        }
+    }
+
+    bool trace_file_reader::read( uint64_t offset, trace_file::record& r ) const {
+        if( offset + trace_file::record_header_size > m_size ) return false;
+        const char* p = m_data + offset;
+        int64_t block_time = 0;
+        memcpy( &r.size, p, sizeof(uint32_t) );
+        memcpy( &r.block_num, p + 4, sizeof(uint32_t) );
+        memcpy( &block_time, p + 8, sizeof(int64_t) );
+        if( offset + trace_file::record_header_size + r.size > m_size ) return false;
+        r.block_time = fc::time_point( fc::microseconds(block_time) );
+        r.data = p + trace_file::record_header_size;
+        return true;
+    }
+
+} // namespace
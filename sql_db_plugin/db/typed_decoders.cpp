@@ -0,0 +1,34 @@
+// #include "typed_decoders.hpp"
+#include <eosio/sql_db_plugin/typed_decoders.hpp>
+
+#include <unordered_map>
+
+namespace eosio {
+
+    const typed_decoder* typed_decoder::find( chain::action_name action ) {
+        static const typed_struct_decoder<token_transfer> transfer;
+        static const typed_struct_decoder<chain::newaccount> newaccount;
+        static const typed_struct_decoder<voteproducer> vote;
+        static const typed_struct_decoder<buyram> buy_ram;
+        static const typed_struct_decoder<buyrambytes> buy_ram_bytes;
+        static const typed_struct_decoder<sellram> sell_ram;
+        static const typed_struct_decoder<delegatebw> delegate;
+        static const typed_struct_decoder<undelegatebw> undelegate;
+
+        // by action name only, the abi check in matches() decides per contract
+        static const std::unordered_map<uint64_t, const typed_decoder*> decoders = {
+            { N(transfer),      &transfer },
+            { N(newaccount),    &newaccount },
+            { N(voteproducer),  &vote },
+            { N(buyram),        &buy_ram },
+            { N(buyrambytes),   &buy_ram_bytes },
+            { N(sellram),       &sell_ram },
+            { N(delegatebw),    &delegate },
+            { N(undelegatebw),  &undelegate },
+        };
+
+        auto itr = decoders.find( action.value );
+        return itr == decoders.end() ? nullptr : itr->second;
+    }
+
+} // namespace
@@ -0,0 +1,179 @@
+// #include "vote_tally.hpp"
+#include <eosio/sql_db_plugin/vote_tally.hpp>
+#include <eosio/sql_db_plugin/metrics.hpp>
+#include <eosio/sql_db_plugin/sql_dialect.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
+
+namespace eosio {
+
+    // a voter changed in this batch, from the cache or else voter_stakes; errors propagate, so a
+    // voter that cannot be read is neither tallied nor written back
+    vote_tally::voter_state& vote_tally::load( soci::session& sql, const chain::account_name& voter ) {
+        auto itr = m_changed.find( voter );
+        if( itr != m_changed.end() ) return itr->second;
+
+        auto cached = m_voters->get( voter.value );
+        if( cached ) return m_changed.emplace( voter, *cached ).first->second;
+
+        voter_state state;
+        const auto name = voter.to_string();
+        long long staked = 0;
+        string producers;
+        soci::indicator staked_ind = soci::i_null, ind = soci::i_null;
+        sql << "SELECT staked, producers FROM voter_stakes WHERE voter = :voter", soci::into(staked, staked_ind), soci::into(producers, ind), soci::use(name);
+        if( sql.got_data() ){
+            if( staked_ind == soci::i_ok ) state.staked = int64_t(staked);
+            else state.staked.reset();
+            if( ind == soci::i_ok && !producers.empty() ){
+                for( const auto& p : fc::json::from_string(producers).as<vector<chain::account_name>>() ){
+                    state.producers.insert( p );
+                }
+            }
+        }
+        return m_changed.emplace( voter, std::move(state) ).first->second;
+    }
+
+    void vote_tally::vote( soci::session& sql, const chain::account_name& voter, const vector<chain::account_name>& producers ) {
+        if( m_skip ) return;
+        auto& state = load( sql, voter );
+        const std::set<chain::account_name> voted( producers.begin(), producers.end() );
+
+        const int64_t staked = state.staked ? *state.staked : 0;
+        for( const auto& p : state.producers ){
+            if( voted.count(p) ) continue;
+            auto& d = m_deltas[ p.to_string() ];
+            d.voters -= 1;
+            d.staked -= staked;
+        }
+        for( const auto& p : voted ){
+            if( state.producers.count(p) ) continue;
+            auto& d = m_deltas[ p.to_string() ];
+            d.voters += 1;
+            d.staked += staked;
+        }
+        state.producers = voted;
+    }
+
+    void vote_tally::stake( soci::session& sql, const chain::account_name& voter, int64_t amount ) {
+        if( m_skip || amount == 0 ) return;
+        auto& state = load( sql, voter );
+        if( !state.staked ) return;
+        if( *state.staked + amount < 0 ){
+            // the stake began before the tally saw it, what the producers got of it comes off again
+            for( const auto& p : state.producers ){
+                m_deltas[ p.to_string() ].staked -= *state.staked;
+            }
+            state.staked.reset();
+            return;
+        }
+        *state.staked += amount;
+        for( const auto& p : state.producers ){
+            m_deltas[ p.to_string() ].staked += amount;
+        }
+    }
+
+    bool vote_tally::flush( soci::session& sql ) {
+        if( m_deltas.empty() && m_changed.empty() && !m_status.behind() ) return true;
+
+        vector<string> producers;
+        vector<long long> voters, producer_staked;
+        for( const auto& d : m_deltas ){
+            // a voter who dropped and re-added a producer within the batch
+            if( d.second.voters == 0 && d.second.staked == 0 ) continue;
+            producers.push_back( d.first );
+            voters.push_back( d.second.voters );
+            producer_staked.push_back( d.second.staked );
+        }
+
+        vector<string> stakers, voted;
+        vector<long long> stakes;
+        vector<soci::indicator> stake_inds;
+        for( const auto& v : m_changed ){
+            stakers.push_back( v.first.to_string() );
+            stakes.push_back( v.second.staked ? *v.second.staked : 0 );
+            stake_inds.push_back( v.second.staked ? soci::i_ok : soci::i_null );
+            voted.push_back( fc::json::to_string( fc::variant( vector<chain::account_name>( v.second.producers.begin(), v.second.producers.end() ) ) ) );
+        }
+
+        // the deltas and changed voters stay until the transaction commits, a failed flush is retried with them
+        try{
+            static auto& flush_latency = metrics::instance().statement("producer_tally.flush");
+            static auto& tally_rows = metrics::instance().rows("producer_tally");
+            static auto& stake_rows = metrics::instance().rows("voter_stakes");
+            metrics::scoped_timer t(flush_latency);
+            const auto dialect = sql_dialect::of(sql);
+            soci::transaction tr(sql);
+
+            if( !producers.empty() ){
+                multi_row_insert( sql, "INSERT INTO producer_tally(producer, voters, staked)", "(?, ?, ?)",
+                        dialect.on_conflict_update("producer",
+                            "voters = " + dialect.current("producer_tally", "voters") + " + " + dialect.excluded("voters") +
+                            ", staked = " + dialect.current("producer_tally", "staked") + " + " + dialect.excluded("staked")) )
+                    .column( producers )
+                    .column( voters )
+                    .column( producer_staked )
+                    .execute();
+            }
+            if( !stakers.empty() ){
+                multi_row_insert( sql, "INSERT INTO voter_stakes(voter, staked, producers)", "(?, ?, ?)",
+                        dialect.on_conflict_update("voter", "staked = " + dialect.excluded("staked") + ", producers = " + dialect.excluded("producers")) )
+                    .column( stakers )
+                    .column( stakes, stake_inds )
+                    .column( voted )
+                    .execute();
+            }
+            m_status.write( sql, dialect );
+            tr.commit();
+            m_status.committed();
+            for( const auto& v : m_changed ){
+                m_voters->put( v.first.value, v.second );
+            }
+            m_changed.clear();
+            m_deltas.clear();
+            tally_rows.add( producers.size() );
+            stake_rows.add( stakers.size() );
+        } catch(soci::soci_error e) {
+            wlog("soci::error: ${e}",("e",e.what()) );
+            return false;
+        } catch(const std::exception& e) {
+            wlog( "flush producer tally failed. ${e}",("e",e.what()) );
+            return false;
+        } catch(...) {
+            wlog( "flush producer tally failed." );
+            return false;
+        }
+        return true;
+    }
+
+    bool vote_tally::flush_apart( soci::session& sql, dead_letter& rejected ) {
+        decltype(m_deltas) deltas;
+        decltype(m_changed) changed;
+        deltas.swap( m_deltas );
+        changed.swap( m_changed );
+
+        auto flush = [&]{ return this->flush( sql ); };
+        m_status.hold( true );
+        const bool ok =
+            flush_entries( deltas, m_deltas, sql, flush, [&]( const decltype(deltas)::value_type& d ){
+                rejected.write( "producer_tally", fc::mutable_variant_object()
+                    ( "producer", d.first )( "voters_delta", int64_t(d.second.voters) )( "staked_delta", int64_t(d.second.staked) ) );
+            }) &&
+            // a voter refused here keeps the state it had before the batch
+            flush_entries( changed, m_changed, sql, flush, [&]( const decltype(changed)::value_type& v ){
+                rejected.write( "voter_stakes", fc::mutable_variant_object()
+                    ( "voter", v.first.to_string() )( "staked", v.second.staked ? fc::variant(*v.second.staked) : fc::variant() )
+                    ( "producers", vector<chain::account_name>( v.second.producers.begin(), v.second.producers.end() ) ) );
+            });
+        m_status.hold( false );
+
+        // what was not tried because the database stopped answering, for the next flush
+        m_deltas.insert( deltas.begin(), deltas.end() );
+        m_changed.insert( changed.begin(), changed.end() );
+        // the watermark, now that every delta is written or rejected
+        return ok && flush( sql );
+    }
+
+} // namespace
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+#include <soci/soci.h>
+
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/sql_db_plugin/lru_cache.hpp>
+
+namespace eosio {
+
+class typed_decoder;
+
+/**
+ * The writer's abi_serializer per contract, so an action is not paying for the abi select, the json
+ * parse and set_abi each time.
+ *
+ * Contracts without an abi are cached too. Entries change only through set(), which the writer calls
+ * when it stores a setabi, so a cached serializer is never older than the abi in the accounts table
+ * it wrote itself.
+ */
+class abi_cache {
+    public:
+        struct entry {
+            chain::abi_serializer serializer;
+            // action name -> whether the abi declares the struct its typed decoder expects
+            std::unordered_map<uint64_t, bool> typed;
+
+            bool typed_match( chain::action_name action, const typed_decoder& decoder );
+        };
+
+        explicit abi_cache( size_t capacity = 1024, fc::microseconds max_serialization_time = fc::microseconds(150*1000) )
+            : m_entries(capacity), m_max_serialization_time(max_serialization_time) {}
+
+        // the serializer of the contract, nullptr if it has no abi
+        std::shared_ptr<entry> get( soci::session& sql, chain::account_name contract );
+        void set( chain::account_name contract, const chain::abi_def& abi );
+
+    private:
+        std::shared_ptr<entry> load( soci::session& sql, chain::account_name contract );
+        std::shared_ptr<entry> make_entry( const chain::abi_def& abi );
+
+        lru_cache<uint64_t, std::shared_ptr<entry>> m_entries;
+        fc::microseconds m_max_serialization_time;
+};
+
+} // namespace
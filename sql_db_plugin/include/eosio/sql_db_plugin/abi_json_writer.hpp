@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/sql_db_plugin/action_data.hpp>
+
+#include <fc/io/datastream.hpp>
+#include <fc/time.hpp>
+
+namespace eosio {
+
+using std::string;
+
+/**
+ * Writes binary data of an abi type as json text, walking the abi type graph and appending straight
+ * to one buffer instead of building an fc::variant tree and printing it.
+ *
+ * The text is what abi_serializer::binary_to_variant followed by fc::json::to_string gives. Types
+ * the writer does not know (abi variants, binary extensions, 128 bit built-ins) throw, and the
+ * caller falls back to binary_to_variant. The buffer is reused by the next write, so one writer per
+ * thread; it holds no other state and works with any abi_serializer, the writer's or the api's.
+ */
+class abi_json_writer {
+    public:
+        explicit abi_json_writer( fc::microseconds max_serialization_time = fc::microseconds(150*1000) )
+            : m_max_serialization_time(max_serialization_time) {}
+
+        // the json of data as type, valid until the next write; args gets the account fields of the
+        // top level struct, as system_contract_arg reads them from the variant
+        const string& write( const chain::abi_serializer& abis, const string& type, const chain::bytes& data,
+                             system_contract_arg* args = nullptr );
+
+    private:
+        using stream = fc::datastream<const char*>;
+
+        void check_deadline() const;
+        void write_type( const string& type, stream& ds, size_t depth );
+        void write_fields( const string& type, stream& ds, size_t depth, bool& first, system_contract_arg* args );
+
+        const chain::abi_serializer* m_abis = nullptr;
+        fc::microseconds m_max_serialization_time;
+        fc::time_point m_deadline;
+        string m_out;
+};
+
+} // namespace
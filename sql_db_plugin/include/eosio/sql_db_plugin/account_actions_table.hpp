@@ -0,0 +1,81 @@
+#pragma once
+
+#include <eosio/sql_db_plugin/table.hpp>
+#include <eosio/sql_db_plugin/dead_letter.hpp>
+
+#include <eosio/chain/types.hpp>
+
+#include <set>
+
+namespace eosio {
+
+using std::string;
+using std::vector;
+
+// filter of one account_actions page; zero or empty fields are unbounded
+struct account_actions_query {
+    string      account;
+    string      contract;
+    string      name;
+    uint32_t    from_block = 0;
+    uint32_t    to_block = 0;
+    uint32_t    from_time = 0;
+    uint32_t    to_time = 0;
+    long long   before = 0;         // cursor, only global sequences below it
+    uint32_t    limit = 50;
+};
+
+struct account_action_row {
+    long long   global_sequence = 0;
+    uint32_t    block_num = 0;
+    uint32_t    block_time = 0;
+    string      transaction_id;
+    string      contract;
+    string      name;
+    string      authorization;
+    string      data;
+};
+
+struct account_actions_page {
+    uint32_t                    head_block_num = 0;
+    vector<account_action_row>  rows;
+};
+
+/**
+ * Per-account index over the actions table.
+ *
+ * Every stored action gets one row per participant (the contract, its authorizers and the accounts
+ * notified), keyed by (account, global sequence), so a history page is a backward range scan of one
+ * index followed by a primary key join to actions. Rows are buffered and written by flush, which
+ * also advances sync_status; reads only return blocks at or below that head.
+ */
+class account_actions_table : public mysql_table {
+    public:
+        account_actions_table(){};
+
+        void add( const std::set<chain::account_name>& participants, const chain::account_name& contract, const chain::action_name& name,
+                  uint64_t global_sequence, uint32_t block_num, uint32_t block_time );
+        bool flush( std::shared_ptr<soci::session>, uint32_t head_block_num );
+        // a row at a time, for a batch flush keeps failing on; rows refused on their own go to rejected
+        bool flush_apart( std::shared_ptr<soci::session>, uint32_t head_block_num, dead_letter& rejected );
+        size_t size() const { return m_accounts.size(); }
+        // the buffered rows, given up on, go to rejected
+        void reject_all( dead_letter& rejected );
+
+        account_actions_page get( std::shared_ptr<soci::session>, const account_actions_query& );
+        // the block sync_status has written up to, 0 before the first flush
+        uint32_t head( std::shared_ptr<soci::session> );
+
+    private:
+        void add_row( const string& account, long long sequence, const string& contract, const string& name, int block_num, long long timestamp );
+        void clear();
+
+        // first or last global sequence of the account inside a block or time bound, 0 if none
+        long long bound( std::shared_ptr<soci::session>, const string& account, const char* index, const char* column, uint32_t value, bool lower );
+
+        vector<string> m_accounts, m_contracts, m_names;
+        vector<long long> m_sequences, m_timestamps;
+        vector<int> m_block_nums;
+};
+
+} // namespace
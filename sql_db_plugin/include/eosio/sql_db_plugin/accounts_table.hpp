@@ -13,6 +13,8 @@ class accounts_table  : public mysql_table {
         void add(std::shared_ptr<soci::session> , string );
         bool exist(std::shared_ptr<soci::session>, string );
         void add_eosio(std::shared_ptr<soci::session>, string ,string );
+        // (account, permission) of every permission holding the key, by account
+        std::vector<std::pair<string, string>> get_key_accounts(std::shared_ptr<soci::session>, const string& public_key );
 
 };
 
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+
+#include <eosio/chain/types.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/optional.hpp>
+#include <fc/variant.hpp>
+
+namespace eosio {
+
+using std::string;
+
+// the account fields of the actions table, taken from the decoded data by field name
+struct system_contract_arg{
+    system_contract_arg() = default;
+    system_contract_arg(const chain::account_name& to, const chain::account_name& from, const chain::account_name& receiver, const chain::account_name& payer, const chain::account_name& name)
+    :to(to), from(from), receiver(receiver), payer(payer), name(name)
+    {}
+    chain::account_name to;
+    chain::account_name from;
+    chain::account_name receiver;
+    chain::account_name payer;
+    chain::account_name name;
+    chain::account_name account;
+};
+
+/**
+ * Decoded action data as the json stored in the data column.
+ *
+ * Typed decoders write the json and the account fields directly; the variant is only built when a
+ * handler asks for it.
+ */
+class action_data {
+    public:
+        action_data() : m_json("{}") {}
+        explicit action_data( const fc::variant& v ) : m_json( fc::json::to_string(v) ), m_variant(v) {}
+        action_data( string json, const system_contract_arg& args ) : m_json( std::move(json) ), m_args(args) {}
+
+        const string& json() const { return m_json; }
+
+        const fc::variant& variant() const {
+            if( !m_variant ) m_variant = fc::json::from_string( m_json );
+            return *m_variant;
+        }
+
+        system_contract_arg args() const {
+            if( m_args ) return *m_args;
+            const auto& v = variant();
+            return v.is_object() ? v.as<system_contract_arg>() : system_contract_arg();
+        }
+
+    private:
+        string m_json;
+        mutable fc::optional<fc::variant> m_variant;
+        fc::optional<system_contract_arg> m_args;
+};
+
+} // namespace
+
+FC_REFLECT( eosio::system_contract_arg                        , (to)(from)(receiver)(payer)(name)(account) )
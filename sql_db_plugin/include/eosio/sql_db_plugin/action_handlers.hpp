@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <soci/soci.h>
+
+#include <eosio/chain/action.hpp>
+#include <eosio/sql_db_plugin/action_data.hpp>
+#include <eosio/sql_db_plugin/derived_tables.hpp>
+#include <eosio/sql_db_plugin/token_registry.hpp>
+#include <eosio/sql_db_plugin/vote_tally.hpp>
+
+namespace eosio {
+
+class sql_dialect;
+
+// what a handler gets for one stored action
+struct action_context {
+    soci::session&                      sql;
+    const sql_dialect&                  dialect;
+    const chain::action&                act;
+    // the action data decoded with the contract's abi, an empty object when it has none; data.variant()
+    // parses the json of a typed decode, handlers of hot actions unpack ctx.act.data themselves
+    const action_data&                  data;
+    std::shared_ptr<token_registry>     tokens;
+    // keyed writes coalesced per batch; sql is for what has to be read back right away
+    derived_tables&                     derived;
+    // producer_tally deltas of votes and stake changes
+    vote_tally&                         tally;
+};
+
+/**
+ * Writers of the derived tables (accounts, votes, proposal, assets...), keyed by (contract, action).
+ *
+ * A handler registered for an empty contract name runs for that action on any contract without a
+ * handler of its own. Lookups happen before an action is decoded for the derived tables, so an
+ * action nobody handles costs one hash lookup.
+ */
+class action_handlers {
+    public:
+        using handler = std::function<void( const action_context& )>;
+
+        static action_handlers& instance();
+
+        void add( chain::account_name contract, chain::action_name action, handler h );
+
+        // the handlers for the action, nullptr if there are none
+        const std::vector<handler>* find( chain::account_name contract, chain::action_name action ) const {
+            auto itr = m_handlers.find( key_type( contract.value, action.value ) );
+            if( itr == m_handlers.end() ) itr = m_handlers.find( key_type( 0, action.value ) );
+            return itr == m_handlers.end() ? nullptr : &itr->second;
+        }
+
+    private:
+        using key_type = std::pair<uint64_t, uint64_t>;
+
+        struct key_hash {
+            size_t operator()( const key_type& k ) const {
+                return std::hash<uint64_t>()( k.first * 0x9E3779B97F4A7C15ull ^ k.second );
+            }
+        };
+
+        std::unordered_map<key_type, std::vector<handler>, key_hash> m_handlers;
+};
+
+// accounts_keys rows of an eosio newaccount, updateauth or deleteauth. Not a handler: the writer calls
+// it for every executed system action, whatever sql_db-action-filter-on stores, so the keys of an
+// account never go stale because its auth actions were filtered out
+void index_permission_keys( derived_tables& derived, const chain::action& act );
+
+/**
+ * Registers a handler during static initialization:
+ *
+ *   static action_handler_registrar on_voteproducer( N(eosio), N(voteproducer), []( const action_context& ctx ){ ... } );
+ *
+ * The registrar has to live in an object file the plugin references, or the linker drops it with
+ * the rest of that file; the built-in handlers are in db/action_handlers.cpp for that reason.
+ */
+struct action_handler_registrar {
+    action_handler_registrar( chain::account_name contract, chain::action_name action, action_handlers::handler h ) {
+        action_handlers::instance().add( contract, action, std::move(h) );
+    }
+};
+
+} // namespace
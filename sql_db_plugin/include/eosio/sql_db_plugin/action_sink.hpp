@@ -0,0 +1,120 @@
+#pragma once
+
+#include <eosio/sql_db_plugin/table.hpp>
+#include <eosio/sql_db_plugin/dead_letter.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eosio {
+
+using std::string;
+using std::vector;
+
+class shard_set;
+
+// one row of the actions table
+struct action_row {
+    string      account;
+    long long   created_at = 0;     // seconds since epoch
+    string      name;
+    string      data;
+    string      authorization;
+    string      transaction_id;
+    string      eosto;
+    string      eosfrom;
+    string      receiver;
+    string      payer;
+    string      newaccount;
+    string      sellram_account;
+    long long   global_sequence = 0;     // the key, a row written twice is stored once
+    int         block_num = 0;
+    int         seq = 0;                 // ordinal in its transaction's action tree, from 1
+    long long   parent = 0;              // seq of the action that sent it, 0 at the top
+};
+
+/**
+ * Where action rows go.
+ *
+ * The writer buffers a batch of rows and hands them over in flush, so each sink can use the bulk
+ * path of its store. Selected with sql_db-sink:
+ *   insert  multi-row INSERT over the session's backend (mysql, postgresql or sqlite3)
+ *   copy    postgresql COPY FROM STDIN, only when built with libpq
+ *   null    decodes and drops the rows, for measuring everything but the store
+ *   auto    copy on postgresql when available, insert otherwise
+ * With several sql_db-uri the rows are spread over the shards by a sharded_action_sink. Rows the
+ * database refuses on their own go to the dead letter file given to create.
+ */
+class action_sink {
+    public:
+        virtual ~action_sink(){}
+
+        void add( action_row row ) { m_rows.push_back( std::move(row) ); }
+        size_t size() const { return m_rows.size(); }
+
+        virtual bool flush( soci::session& ) = 0;
+        // a row at a time, for a batch flush keeps failing on; rows refused on their own are rejected
+        virtual bool flush_apart( soci::session& );
+
+        // false if rows never reach the actions table, so nothing may reference them
+        virtual bool stores_rows() const { return true; }
+
+        // the buffered rows, given up on, go to the dead letter file
+        void reject_all();
+        // rows of shards that did not commit, which the batch no longer holds; they go to the dead
+        // letter file when the writer stops
+        virtual void reject_backlog(){}
+
+        static std::shared_ptr<action_sink> create( const string& kind, const string& backend_name, std::shared_ptr<dead_letter> rejected );
+
+    protected:
+        void reject( const action_row& );
+
+        vector<action_row> m_rows;
+        std::shared_ptr<dead_letter> m_dead_letter;
+};
+
+// a batch the database refuses is split until the refused rows are found, the others are written
+class insert_action_sink : public action_sink {
+    public:
+        bool flush( soci::session& ) override;
+
+    private:
+        bool try_insert( soci::session&, vector<action_row>& rows, size_t begin, size_t end );
+        void split( soci::session&, vector<action_row>& rows, size_t begin, size_t end, vector<action_row>& left );
+};
+
+#ifdef SQL_DB_HAVE_POSTGRESQL
+class copy_action_sink : public action_sink {
+    public:
+        bool flush( soci::session& ) override;
+};
+#endif
+
+class null_action_sink : public action_sink {
+    public:
+        bool flush( soci::session& ) override { m_rows.clear(); return true; }
+        bool stores_rows() const override { return false; }
+};
+
+// hands each row to the sink of its contract's shard; shard 0 flushes on the writer's session and
+// alone decides the result, the sinks of the other shards keep what they fail to write
+class sharded_action_sink : public action_sink {
+    public:
+        sharded_action_sink( std::shared_ptr<shard_set> shards, vector<std::shared_ptr<action_sink>> sinks )
+            : m_shards(std::move(shards)), m_sinks(std::move(sinks)) {}
+
+        bool flush( soci::session& ) override;
+        bool flush_apart( soci::session& ) override;
+        bool stores_rows() const override { return m_sinks.front()->stores_rows(); }
+        void reject_backlog() override;
+
+    private:
+        bool flush_shards( soci::session&, bool apart );
+
+        std::shared_ptr<shard_set>              m_shards;
+        vector<std::shared_ptr<action_sink>>    m_sinks;
+};
+
+} // namespace
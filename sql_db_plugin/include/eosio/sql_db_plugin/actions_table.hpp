@@ -1,6 +1,13 @@
 #pragma once
 
 #include <eosio/sql_db_plugin/table.hpp>
+#include <eosio/sql_db_plugin/token_registry.hpp>
+#include <eosio/sql_db_plugin/action_sink.hpp>
+#include <eosio/sql_db_plugin/action_data.hpp>
+#include <eosio/sql_db_plugin/derived_tables.hpp>
+#include <eosio/sql_db_plugin/vote_tally.hpp>
+#include <eosio/sql_db_plugin/abi_cache.hpp>
+#include <eosio/sql_db_plugin/abi_json_writer.hpp>
 
 #include <vector>
 
@@ -19,38 +26,37 @@ namespace eosio {
 using std::string;
 using std::vector;
 
-struct system_contract_arg{
-    system_contract_arg() = default;
-    system_contract_arg(const chain::account_name& to, const chain::account_name& from, const chain::account_name& receiver, const chain::account_name& payer, const chain::account_name& name)
-    :to(to), from(from), receiver(receiver), payer(payer), name(name)
-    {}
-    chain::account_name to;
-    chain::account_name from;
-    chain::account_name receiver;
-    chain::account_name payer;
-    chain::account_name name;
-    chain::account_name account;
-};
-
 class actions_table : public mysql_table {
     public:
         actions_table(){}
 
-        bool add( std::shared_ptr<soci::session>, chain::action , chain::transaction_id_type , chain::block_timestamp_type , std::vector<std::string> ); 
-        void parse_actions( std::shared_ptr<soci::session>, chain::action );
-        string add_data( std::shared_ptr<soci::session>, chain::action );
+        bool add( std::shared_ptr<soci::session>, chain::action , chain::transaction_id_type , chain::block_timestamp_type , std::vector<std::string>, uint64_t global_sequence = 0, uint32_t block_num = 0,
+                  uint32_t seq = 0, uint32_t parent = 0 );
+        // runs the derived-table handlers registered for the action
+        void parse_actions( std::shared_ptr<soci::session>, const chain::action&, const action_data& data );
+        // the action data decoded with a typed decoder or the contract's abi, storing the abi of a setabi
+        action_data add_data( std::shared_ptr<soci::session>, const chain::action& );
         soci::rowset<soci::row> get_assets( std::shared_ptr<soci::session>, int ,int );
         soci::rowset<soci::row> get_assets( std::shared_ptr<soci::session> );
+        soci::rowset<soci::row> get_assets_after( std::shared_ptr<soci::session>, long long, int );
         soci::rowset<soci::row> get_proposal(std::shared_ptr<soci::session>, string );
 
         static const chain::account_name newaccount;
         static const chain::account_name setabi;
+
+        std::shared_ptr<token_registry> m_token_registry;
+        // stored actions are buffered here and written when the batch is flushed
+        std::shared_ptr<action_sink> m_sink;
+        abi_cache m_abi_cache;
+        // derived table writes of the handlers, flushed with the batch
+        derived_tables m_derived;
+        vote_tally m_vote_tally;
+        abi_json_writer m_json_writer;
 };
 
 
 } // namespace
 
-FC_REFLECT( eosio::system_contract_arg                        , (to)(from)(receiver)(payer)(name)(account) )
 
 
 
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+
+#include <soci/soci.h>
+
+#include <eosio/sql_db_plugin/sql_dialect.hpp>
+
+#include <fc/log/logger.hpp>
+
+namespace eosio {
+
+using std::string;
+
+/**
+ * How far a table written as increments has applied the action stream, by global sequence.
+ *
+ * producer_tally, the hourly rollups and token balances add each batch onto the stored rows, so a
+ * trace written twice, like a batch the spill journal replays because it never saw its commit,
+ * would be counted twice. Each of them keeps the last global sequence it committed in apply_status,
+ * written in the same transaction as its increments, and skips the traces at or below it. Traces
+ * reach the writer in order and never span two batches, so a trace is applied whole or not at all.
+ */
+class apply_status {
+    public:
+        explicit apply_status( string name ) : m_name(std::move(name)) {}
+
+        void load( soci::session& sql ) {
+            try{
+                long long applied = 0;
+                sql << "SELECT global_sequence FROM apply_status WHERE name = :na", soci::into(applied), soci::use(m_name);
+                if( sql.got_data() ) m_applied = m_pending = applied;
+            } catch(soci::soci_error e) {
+                wlog("soci::error: ${e}",("e",e.what()) );
+            }
+        }
+
+        // false if a committed batch already applied the trace ending at global_sequence
+        bool take( uint64_t global_sequence ) {
+            if( global_sequence == 0 ) return true;     // no receipt to go by
+            if( global_sequence <= m_applied ) return false;
+            m_pending = std::max( m_pending, global_sequence );
+            return true;
+        }
+
+        // traces taken since the last commit, the watermark is still to be written
+        bool behind() const { return m_pending != m_applied; }
+
+        // while held the watermark stays where it is, so a batch written a row at a time only moves it
+        // once every row is through
+        void hold( bool held ) { m_held = held; }
+
+        // inside the transaction of the increments
+        void write( soci::session& sql, const sql_dialect& dialect ) {
+            if( m_held || m_pending == m_applied ) return;
+            const long long pending = m_pending;
+            sql << dialect.upsert("apply_status(name, global_sequence) VALUES (:na, :gs)", "name", "global_sequence = " + dialect.excluded("global_sequence")),
+                soci::use(m_name),
+                soci::use(pending);
+        }
+
+        void committed() { if( !m_held ) m_applied = m_pending; }
+
+    private:
+        const string    m_name;
+        uint64_t        m_applied = 0;
+        uint64_t        m_pending = 0;
+        bool            m_held = false;
+};
+
+} // namespace
@@ -8,6 +8,7 @@
 
 namespace eosio {
 
+// mysql only (REPLACE INTO, FROM_UNIXTIME), the block state path that used it is not connected
 class blocks_table : public mysql_table {
     public:
         blocks_table(){};
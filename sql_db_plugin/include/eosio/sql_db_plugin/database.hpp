@@ -11,7 +11,17 @@
 #include <eosio/sql_db_plugin/transactions_table.hpp>
 #include <eosio/sql_db_plugin/blocks_table.hpp>
 #include <eosio/sql_db_plugin/actions_table.hpp>
+#include <eosio/sql_db_plugin/tokens_table.hpp>
+#include <eosio/sql_db_plugin/account_actions_table.hpp>
+#include <eosio/sql_db_plugin/rollup_tables.hpp>
 #include <eosio/sql_db_plugin/session_pool.hpp>
+#include <eosio/sql_db_plugin/shard_set.hpp>
+#include <eosio/sql_db_plugin/read_router.hpp>
+#include <eosio/sql_db_plugin/proposal_index.hpp>
+#include <eosio/sql_db_plugin/holder_index.hpp>
+#include <eosio/sql_db_plugin/key_index.hpp>
+#include <eosio/sql_db_plugin/trx_dedup.hpp>
+#include <eosio/sql_db_plugin/dead_letter.hpp>
 
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
@@ -30,16 +40,65 @@ class sql_database {
 
         void consume_transaction_metadata( const chain::transaction_metadata_ptr& );
         void consume_transaction_trace( const chain::transaction_trace_ptr& );
+        bool is_duplicate( soci::session&, const chain::transaction_trace_ptr& );
 
-        void dfs_inline_traces( std::shared_ptr<soci::session>, vector<chain::action_trace>,  chain::transaction_id_type, chain::block_timestamp_type );
+        // ordinal counts the actions of the transaction walked so far, parent is the ordinal of their sender
+        void dfs_inline_traces( std::shared_ptr<soci::session>, const vector<chain::action_trace>&,  chain::transaction_id_type, chain::block_timestamp_type, uint32_t,
+                                uint32_t& ordinal, uint32_t parent );
+        void index_inline_traces( std::shared_ptr<soci::session>, const vector<chain::action_trace>&, chain::block_timestamp_type );
+        void index_token_action( std::shared_ptr<soci::session>, const chain::action&, chain::block_timestamp_type );
+        // false if a table of the primary failed to write, its rows stay buffered for the next call.
+        // With apart a table that fails is written again a row at a time, the rows the database refuses
+        // on their own go to m_dead_letter and the others are written. Shards 1.. that fail keep their
+        // rows for a later call without failing the batch
+        bool flush( bool apart = false );
+        // when the writer stops: the shards still holding rows back get a last try, the rows left
+        // then go to m_dead_letter since the batches they came from are committed
+        void drain_shards();
+        // after m_dead_letter is set, the sinks write the rows the database refuses to it
+        void set_action_sink( const std::string& kind );
+        // spreads actions over the primary and these databases, before set_action_sink
+        void set_shards( const std::vector<std::string>& shard_uris, size_t pool_size );
+        // records the databases in the primary's shards table on the first start and asserts they are
+        // the same ones on every later start, a changed list would hash contracts to other shards
+        void check_shards( const std::vector<std::string>& uris );
+        account_actions_table& account_actions_of( size_t shard );
+        void flush_shard_account_actions( uint32_t head_block_num );
+        // a page of every shard's account_actions, merged newest first
+        account_actions_page get_account_actions( const account_actions_query& );
+
+        // api reads go to a read replica when one is configured and caught up
+        std::shared_ptr<soci::session> get_read_session();
+        void load_token_registry();
+        // where the increment tables left off, before the writer consumes its first trace
+        void load_apply_status();
 
         std::shared_ptr<soci_session_pool> m_session_pool;
+        std::shared_ptr<read_router> m_read_router;
         std::unique_ptr<actions_table> m_actions_table;
         std::unique_ptr<accounts_table> m_accounts_table;
         std::unique_ptr<blocks_table> m_blocks_table;
         std::unique_ptr<transactions_table> m_transactions_table;
+        std::unique_ptr<tokens_table> m_tokens_table;
+        std::unique_ptr<account_actions_table> m_account_actions_table;
+        // unset with a single database; the buffers of shards 1.. follow m_account_actions_table of shard 0
+        std::shared_ptr<shard_set> m_shards;
+        std::vector<std::unique_ptr<account_actions_table>> m_shard_account_actions;
+        std::unique_ptr<rollup_tables> m_rollup_tables;
+        std::shared_ptr<proposal_index> m_proposal_index;
+        std::shared_ptr<token_registry> m_token_registry;
+        std::shared_ptr<holder_index> m_holder_index;
+        std::shared_ptr<key_index> m_key_index;
+        // rows the database refused, only logged unless given a file
+        std::shared_ptr<dead_letter> m_dead_letter;
+        // drops traces of transactions already written, unset to write every trace
+        std::unique_ptr<trx_dedup> m_dedup;
         std::string system_account;
         uint32_t m_block_num_start;
+        uint32_t m_last_block_num = 0;
+        // producer of the block the incoming traces belong to, taken from its onblock
+        chain::account_name m_block_producer;
+        uint32_t m_producer_block_num = 0;
         std::vector<std::string> m_action_filter_on;
         std::vector<std::string> m_contract_filter_out;
 
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+
+#include <soci/soci.h>
+
+#include <fc/variant.hpp>
+
+namespace eosio {
+
+using std::string;
+
+/**
+ * Rows the database refused, appended to a file one json object per line:
+ *
+ *   {"time":"2018-06-01T12:00:00","table":"actions","row":{...}}
+ *
+ * so they can be corrected and written by hand. A row only ends up here when the database still
+ * answers but will not take that row on its own; a batch that fails because the database is
+ * unreachable is kept and retried instead. The exception are the rows a shard other than the primary
+ * holds back: they land here once there are more than shard_set::backlog_limit of them, or when the
+ * writer stops, since their batches are already committed. Without a path the rows are only logged.
+ */
+class dead_letter {
+    public:
+        dead_letter(){}
+        explicit dead_letter( const string& path );
+
+        void write( const string& table, const fc::variant& row );
+
+        const string& path() const { return m_path; }
+
+    private:
+        string          m_path;
+        boost::mutex    m_mutex;
+        std::ofstream   m_out;
+};
+
+// false if the session's database does not answer, a failed statement then says nothing about its rows
+bool database_answers( soci::session& sql );
+
+/**
+ * For a batch whose flush keeps failing as a whole: moves the entries of pending into buffer one at
+ * a time and flushes each on its own. flush is the table's flush, which empties buffer when it
+ * commits. An entry refused while the database still answers goes to reject and is dropped; once the
+ * database stops answering, that entry and the ones after it stay in pending and false is returned.
+ * For the map and set buffers of the tables.
+ */
+template<typename Container, typename Flush, typename Reject>
+bool flush_entries( Container& pending, Container& buffer, soci::session& sql, Flush flush, Reject reject ) {
+    while( !pending.empty() ){
+        auto itr = pending.begin();
+        buffer.insert( *itr );
+        if( !flush() ){
+            buffer.clear();
+            if( !database_answers(sql) ) return false;
+            reject( *itr );
+        }
+        pending.erase( itr );
+    }
+    return true;
+}
+
+} // namespace
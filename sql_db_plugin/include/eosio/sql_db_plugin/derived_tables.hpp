@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+
+#include <soci/soci.h>
+
+#include <eosio/sql_db_plugin/dead_letter.hpp>
+#include <eosio/sql_db_plugin/key_index.hpp>
+#include <eosio/sql_db_plugin/token_registry.hpp>
+
+#include <fc/optional.hpp>
+
+namespace eosio {
+
+using std::string;
+
+/**
+ * Writes of the derived tables (accounts, accounts_keys, votes, proposal, assets) collected over a
+ * batch of traces.
+ *
+ * Only the last write per key is kept, and flush sends each table as one multi-row upsert in key
+ * order, so a voter who votes ten times in a batch costs one row and two writers flushing
+ * overlapping keys lock them in the same order instead of deadlocking.
+ */
+class derived_tables {
+    public:
+        struct asset_row {
+            long long   supply = 0;
+            long long   max_supply = 0;
+            int         precision = 0;
+            string      symbol;
+            string      issuer;
+            string      contract_owner;
+        };
+
+        void add_account( const string& name );
+        // the keys of a permission are replaced as a whole, an empty list deletes the permission
+        void set_permission_keys( const string& account, const string& permission, vector<string> public_keys );
+        void set_vote( const string& voter, const string& proxy, const string& producers );
+        void set_proposal( const string& proposer, const string& proposal_name, const string& requested_approvals );
+        void remove_proposal( const string& proposer, const string& proposal_name );
+        // the token goes into the registry with its assets id once the flush commits
+        void set_asset( const asset_row& row );
+        // a token created in this batch that is not in the registry yet, with id 0, so the actions of
+        // the same batch can use it
+        fc::optional<token_registry::token_info> pending_token( const chain::account_name& contract, const string& symbol ) const;
+
+        bool flush( soci::session& sql, const std::shared_ptr<token_registry>& tokens, const std::shared_ptr<key_index>& keys );
+        // a row at a time, for a batch flush keeps failing on; rows refused on their own go to rejected
+        bool flush_apart( soci::session& sql, const std::shared_ptr<token_registry>& tokens, const std::shared_ptr<key_index>& keys, dead_letter& rejected );
+
+    private:
+        void register_tokens( soci::session& sql, token_registry& tokens );
+
+        std::set<string> m_accounts;
+        // (account, permission) -> public keys
+        std::map<std::pair<string, string>, vector<string>> m_permission_keys;
+        // voter -> (proxy, producers)
+        std::map<string, std::pair<string, string>> m_votes;
+        // (proposer, proposal_name) -> requested approvals, unset when the proposal is gone
+        std::map<std::pair<string, string>, fc::optional<string>> m_proposals;
+        // (symbol, contract_owner) -> row
+        std::map<std::pair<string, string>, asset_row> m_assets;
+        // (symbol, contract_owner) -> committed row whose assets id is not read back yet
+        std::map<std::pair<string, string>, asset_row> m_unregistered;
+};
+
+} // namespace
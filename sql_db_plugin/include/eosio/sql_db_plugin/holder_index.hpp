@@ -0,0 +1,60 @@
+#pragma once
+
+#include <set>
+#include <atomic>
+
+#include <eosio/chain/types.hpp>
+#include <eosio/sql_db_plugin/lru_cache.hpp>
+
+namespace eosio {
+
+/**
+ * Hot cache over the account_tokens table: account -> token contracts it has ever received.
+ *
+ * The api fills account entries from sql on a miss; the writer extends cached entries as it records
+ * new holders and remembers recently written pairs so repeated transfers do not hit sql again.
+ */
+class holder_index {
+    public:
+        typedef std::set<chain::account_name> contract_set;
+
+        struct pair_hash {
+            size_t operator()( const std::pair<chain::account_name, chain::account_name>& p ) const {
+                return std::hash<uint64_t>()( p.first.value ) ^ ( std::hash<uint64_t>()( p.second.value ) << 1 );
+            }
+        };
+
+        explicit holder_index( size_t capacity ) : m_accounts(capacity), m_written(capacity) {}
+
+        // true if the pair may be missing from sql and has to be written
+        bool should_write( const chain::account_name& account, const chain::account_name& contract ) {
+            return !m_written.contains( std::make_pair(account, contract) );
+        }
+
+        void written( const chain::account_name& account, const chain::account_name& contract ) {
+            m_written.put( std::make_pair(account, contract), true );
+            ++m_version;
+            m_accounts.modify( account, [&]( contract_set& s ){ s.insert(contract); } );
+        }
+
+        fc::optional<contract_set> get( const chain::account_name& account ) {
+            return m_accounts.get( account );
+        }
+
+        uint64_t version() const {
+            return m_version.load();
+        }
+
+        // an api load is only cached if no holder was written while it read sql
+        void put( const chain::account_name& account, const contract_set& contracts, uint64_t version ) {
+            if( version != m_version.load() ) return;
+            m_accounts.put( account, contracts );
+        }
+
+    private:
+        lru_cache<chain::account_name, contract_set> m_accounts;
+        lru_cache<std::pair<chain::account_name, chain::account_name>, bool, pair_hash> m_written;
+        std::atomic<uint64_t> m_version{0};
+};
+
+} // namespace
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <set>
+#include <vector>
+
+#include <eosio/chain/types.hpp>
+#include <eosio/sql_db_plugin/lru_cache.hpp>
+
+namespace eosio {
+
+using std::string;
+using std::vector;
+
+/**
+ * Hot cache over the accounts_keys table: public key -> the (account, permission) pairs it is in.
+ *
+ * The api fills entries from sql on a miss. After the writer commits permission changes it drops the
+ * entries of the keys it added and every entry listing a permission it changed, since the keys a
+ * permission lost are not known without reading them back.
+ */
+class key_index {
+    public:
+        typedef std::pair<chain::account_name, chain::permission_name> permission_ref;
+        typedef vector<permission_ref> permissions;
+
+        explicit key_index( size_t capacity ) : m_keys(capacity) {}
+
+        fc::optional<permissions> get( const string& public_key ) {
+            return m_keys.get( public_key );
+        }
+
+        uint64_t version() const {
+            return m_version.load();
+        }
+
+        // an api load is only cached if no permission changed while it read sql
+        void put( const string& public_key, const permissions& refs, uint64_t version ) {
+            if( version != m_version.load() ) return;
+            m_keys.put( public_key, refs );
+        }
+
+        void changed( const std::set<permission_ref>& changed_permissions, const vector<string>& added_keys ) {
+            if( changed_permissions.empty() ) return;
+            ++m_version;
+            for( const auto& key : added_keys ){
+                m_keys.erase( key );
+            }
+            m_keys.erase_if( [&]( const string&, const permissions& refs ){
+                for( const auto& r : refs ){
+                    if( changed_permissions.count(r) ) return true;
+                }
+                return false;
+            });
+        }
+
+    private:
+        lru_cache<string, permissions> m_keys;
+        std::atomic<uint64_t> m_version{0};
+};
+
+} // namespace
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+
+#include <boost/thread/mutex.hpp>
+
+#include <fc/optional.hpp>
+
+namespace eosio {
+
+/**
+ * Small thread-safe least-recently-used map used by the in-memory caches.
+ * A capacity of 0 disables the cache.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class lru_cache {
+    public:
+        explicit lru_cache( size_t capacity ) : m_capacity(capacity) {}
+
+        fc::optional<Value> get( const Key& key ) {
+            boost::mutex::scoped_lock lock(m_mutex);
+            auto itr = m_map.find(key);
+            if( itr == m_map.end() ) return fc::optional<Value>();
+            m_list.splice( m_list.begin(), m_list, itr->second );
+            return itr->second->second;
+        }
+
+        bool contains( const Key& key ) {
+            boost::mutex::scoped_lock lock(m_mutex);
+            return m_map.find(key) != m_map.end();
+        }
+
+        void put( const Key& key, const Value& value ) {
+            if( m_capacity == 0 ) return;
+            boost::mutex::scoped_lock lock(m_mutex);
+            auto itr = m_map.find(key);
+            if( itr != m_map.end() ){
+                itr->second->second = value;
+                m_list.splice( m_list.begin(), m_list, itr->second );
+                return;
+            }
+            m_list.emplace_front( key, value );
+            m_map[key] = m_list.begin();
+            if( m_map.size() > m_capacity ){
+                m_map.erase( m_list.back().first );
+                m_list.pop_back();
+            }
+        }
+
+        // updates the value in place if the key is cached, returns false otherwise
+        template<typename Function>
+        bool modify( const Key& key, Function f ) {
+            boost::mutex::scoped_lock lock(m_mutex);
+            auto itr = m_map.find(key);
+            if( itr == m_map.end() ) return false;
+            f( itr->second->second );
+            return true;
+        }
+
+        void erase( const Key& key ) {
+            boost::mutex::scoped_lock lock(m_mutex);
+            auto itr = m_map.find(key);
+            if( itr == m_map.end() ) return;
+            m_list.erase(itr->second);
+            m_map.erase(itr);
+        }
+
+        template<typename Predicate>
+        void erase_if( Predicate p ) {
+            boost::mutex::scoped_lock lock(m_mutex);
+            for( auto itr = m_list.begin(); itr != m_list.end(); ){
+                if( p(itr->first, itr->second) ){
+                    m_map.erase(itr->first);
+                    itr = m_list.erase(itr);
+                } else {
+                    ++itr;
+                }
+            }
+        }
+
+        void clear() {
+            boost::mutex::scoped_lock lock(m_mutex);
+            m_map.clear();
+            m_list.clear();
+        }
+
+        size_t size() {
+            boost::mutex::scoped_lock lock(m_mutex);
+            return m_map.size();
+        }
+
+    private:
+        typedef std::list<std::pair<Key, Value>> list_type;
+
+        size_t m_capacity;
+        list_type m_list;
+        std::unordered_map<Key, typename list_type::iterator, Hash> m_map;
+        boost::mutex m_mutex;
+};
+
+} // namespace
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+
+#include <fc/time.hpp>
+#include <fc/variant.hpp>
+
+namespace eosio {
+
+using std::string;
+
+/**
+ * Process-wide ingestion and api metrics.
+ *
+ * Recording is a relaxed atomic add. Named series are created on first use under a mutex and never
+ * freed, so call sites keep a reference in a function-local static and the hot path never locks;
+ * collection only takes the mutex to walk the series.
+ */
+class metrics {
+    public:
+        class counter {
+            public:
+                void add( uint64_t n = 1 ) { m_value.fetch_add( n, std::memory_order_relaxed ); }
+                uint64_t value() const { return m_value.load( std::memory_order_relaxed ); }
+            private:
+                std::atomic<uint64_t> m_value{0};
+        };
+
+        class gauge {
+            public:
+                void add( int64_t n ) { m_value.fetch_add( n, std::memory_order_relaxed ); }
+                int64_t value() const { return m_value.load( std::memory_order_relaxed ); }
+            private:
+                std::atomic<int64_t> m_value{0};
+        };
+
+        // microseconds, bucket i counts observations up to 16us << i, the last one everything above
+        class histogram {
+            public:
+                static constexpr size_t buckets = 22;
+
+                void observe( uint64_t us ) {
+                    m_buckets[ bucket(us) ].fetch_add( 1, std::memory_order_relaxed );
+                    m_count.fetch_add( 1, std::memory_order_relaxed );
+                    m_sum.fetch_add( us, std::memory_order_relaxed );
+                }
+
+                static uint64_t upper_bound( size_t i ) { return uint64_t(16) << i; }
+                uint64_t count( size_t i ) const { return m_buckets[i].load( std::memory_order_relaxed ); }
+                uint64_t count() const { return m_count.load( std::memory_order_relaxed ); }
+                uint64_t sum() const { return m_sum.load( std::memory_order_relaxed ); }
+
+            private:
+                static size_t bucket( uint64_t us ) {
+                    if( us <= 16 ) return 0;
+                    size_t b = 64 - __builtin_clzll( us - 1 ) - 4;
+                    return b < buckets ? b : buckets - 1;
+                }
+
+                std::array<std::atomic<uint64_t>, buckets> m_buckets{};
+                std::atomic<uint64_t> m_count{0};
+                std::atomic<uint64_t> m_sum{0};
+        };
+
+        class scoped_timer {
+            public:
+                explicit scoped_timer( histogram& h ) : m_histogram(h), m_start(fc::time_point::now()) {}
+                ~scoped_timer() { m_histogram.observe( (fc::time_point::now() - m_start).count() ); }
+            private:
+                histogram& m_histogram;
+                fc::time_point m_start;
+        };
+
+        static metrics& instance();
+
+        counter& rows( const string& table );
+        histogram& statement( const string& name );
+        histogram& endpoint( const string& name );
+
+        gauge trace_queue_depth;
+        gauge trace_queue_bytes;
+        gauge block_queue_depth;
+        gauge block_queue_bytes;
+        gauge spill_depth;
+        gauge spill_bytes;
+        histogram enqueue_wait;
+        histogram decode;
+        counter decode_typed;
+        counter decode_abi;
+        histogram pool_lease_wait;
+        counter abi_cache_hits;
+        counter abi_cache_misses;
+        counter traces_not_executed;
+        counter traces_duplicate;
+        counter spill_skipped;
+        counter rows_rejected;
+
+        fc::variant to_variant();
+        string to_prometheus();
+
+    private:
+        metrics() : m_started(fc::time_point::now()) {}
+
+        template<typename T>
+        T& series( std::map<string, std::unique_ptr<T>>& m, const string& name ) {
+            boost::mutex::scoped_lock lock(m_mutex);
+            auto& s = m[name];
+            if( !s ) s.reset( new T() );
+            return *s;
+        }
+
+        fc::time_point m_started;
+        boost::mutex m_mutex;
+        std::map<string, std::unique_ptr<counter>> m_rows;
+        std::map<string, std::unique_ptr<histogram>> m_statements;
+        std::map<string, std::unique_ptr<histogram>> m_endpoints;
+};
+
+} // namespace
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <memory>
+
+#include <boost/thread/shared_mutex.hpp>
+
+#include <eosio/chain/action.hpp>
+#include <eosio/chain/transaction.hpp>
+
+namespace eosio {
+
+using std::string;
+using std::vector;
+
+// eosio.msig action payloads, unpacked straight from action.data
+struct msig_propose {
+    chain::account_name              proposer;
+    chain::name                      proposal_name;
+    vector<chain::permission_level>  requested;
+    chain::transaction               trx;
+};
+
+struct msig_approve {
+    chain::account_name      proposer;
+    chain::name              proposal_name;
+    chain::permission_level  level;
+};
+
+// exec and cancel share the same leading fields
+struct msig_close {
+    chain::account_name      proposer;
+    chain::name              proposal_name;
+};
+
+// eosio.msig table rows, used to bootstrap the index from chain state
+struct msig_proposal_row {
+    chain::name              proposal_name;
+    vector<char>             packed_transaction;
+};
+
+struct msig_approvals_row {
+    chain::name                      proposal_name;
+    vector<chain::permission_level>  requested_approvals;
+    vector<chain::permission_level>  provided_approvals;
+};
+
+/**
+ * In-memory index of open eosio.msig proposals.
+ *
+ * Maintained by the writer thread from propose/approve/unapprove/exec/cancel and read by the api.
+ * Entries are immutable once published; every change swaps in a new entry, so readers can hold
+ * on to an entry without locking. The rendered transaction json and the authorization status are
+ * filled in lazily by the api (they need chain state) and dropped whenever the approvals change.
+ */
+class proposal_index {
+    public:
+        struct entry {
+            chain::account_name              proposer;
+            chain::name                      proposal_name;
+            chain::transaction               trx;
+            vector<chain::permission_level>  requested_approvals;
+            vector<chain::permission_level>  provided_approvals;
+            std::shared_ptr<const string>    transaction_json;
+            fc::optional<uint8_t>            status;
+        };
+        typedef std::shared_ptr<const entry> entry_ptr;
+        typedef std::pair<chain::account_name, chain::name> key_type;
+
+        proposal_index(){}
+
+        void apply( const chain::action& );
+        void add( const chain::account_name&, const msig_approvals_row&, chain::transaction );
+        void clear();
+
+        entry_ptr get( const chain::account_name& proposer, const chain::name& proposal_name ) const;
+        vector<entry_ptr> get_pending( const chain::account_name& approver ) const;
+        vector<entry_ptr> get_by_proposer( const chain::account_name& proposer ) const;
+
+        // publish api-side rendering, unless the entry changed in the meantime
+        void set_rendered( const entry_ptr&, std::shared_ptr<const string>, uint8_t );
+
+    private:
+        void propose( const msig_propose& );
+        void approve( const msig_approve& );
+        void unapprove( const msig_approve& );
+        void remove( const key_type& );
+        void publish( const key_type&, const std::shared_ptr<entry>& );
+
+        std::map<key_type, entry_ptr> m_proposals;
+        std::map<chain::account_name, std::set<key_type>> m_by_approver;
+        mutable boost::shared_mutex m_mutex;
+};
+
+} // namespace
+
+FC_REFLECT( eosio::msig_propose, (proposer)(proposal_name)(requested)(trx) )
+FC_REFLECT( eosio::msig_approve, (proposer)(proposal_name)(level) )
+FC_REFLECT( eosio::msig_close, (proposer)(proposal_name) )
+FC_REFLECT( eosio::msig_proposal_row, (proposal_name)(packed_transaction) )
+FC_REFLECT( eosio::msig_approvals_row, (proposal_name)(requested_approvals)(provided_approvals) )
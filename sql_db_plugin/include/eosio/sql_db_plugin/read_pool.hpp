@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace eosio {
+
+/**
+ * Worker threads for api calls that block on sql.
+ *
+ * Work posted here must not touch chainbase; results are handed back to the application thread.
+ */
+class read_pool {
+    public:
+        explicit read_pool( size_t threads )
+            : m_work( new boost::asio::io_service::work(m_ios) ) {
+            for( size_t i = 0; i < threads; ++i ){
+                m_threads.create_thread( [this]{ m_ios.run(); } );
+            }
+        }
+
+        ~read_pool() {
+            stop();
+        }
+
+        template<typename Function>
+        void post( Function f ) {
+            m_ios.post( f );
+        }
+
+        void stop() {
+            m_work.reset();
+            m_ios.stop();
+            m_threads.join_all();
+        }
+
+    private:
+        boost::asio::io_service m_ios;
+        std::unique_ptr<boost::asio::io_service::work> m_work;
+        boost::thread_group m_threads;
+};
+
+} // namespace
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <eosio/sql_db_plugin/session_pool.hpp>
+
+#include <fc/log/logger.hpp>
+#include <fc/time.hpp>
+
+namespace eosio {
+
+/**
+ * Routes api reads across read replicas.
+ *
+ * Replicas are used round-robin while they answer and their replication lag is within bounds;
+ * lag is sampled at most every check_interval per replica. When no replica qualifies the read goes
+ * to the primary pool.
+ */
+class read_router {
+    public:
+        read_router( const std::vector<std::string>& uris, size_t pool_size, uint32_t max_lag_sec, std::shared_ptr<soci_session_pool> primary )
+            : m_pool_size(pool_size), m_max_lag_sec(max_lag_sec), m_primary(primary) {
+            for( const auto& uri : uris ){
+                auto r = std::make_unique<replica>();
+                r->uri = uri;
+                m_replicas.emplace_back( std::move(r) );
+            }
+        }
+
+        std::shared_ptr<soci::session> get_session() {
+            for( size_t i = 0; i < m_replicas.size(); ++i ){
+                auto& r = *m_replicas[ m_next++ % m_replicas.size() ];
+                if( !check(r) ) continue;
+                try {
+                    return r.pool->get_session();
+                } catch (std::exception& e) {
+                    wlog("read replica ${u} failed: ${e}",("u",r.uri)("e",e.what()));
+                    r.healthy = false;
+                }
+            }
+            return m_primary->get_session();
+        }
+
+    private:
+        struct replica {
+            std::string                         uri;
+            std::shared_ptr<soci_session_pool>  pool;
+            std::atomic<bool>                   healthy{false};
+            fc::time_point                      last_check;
+            boost::mutex                        mtx;
+        };
+
+        bool check( replica& r ) {
+            boost::mutex::scoped_lock lock(r.mtx, boost::try_to_lock);
+            if( !lock.owns_lock() ) return r.healthy;
+            auto now = fc::time_point::now();
+            if( now - r.last_check < check_interval ) return r.healthy;
+            r.last_check = now;
+
+            try {
+                if( !r.pool ) r.pool = std::make_shared<soci_session_pool>( m_pool_size, r.uri );
+                auto lag = replication_lag( *r.pool->get_session() );
+                bool healthy = lag >= 0 && lag <= m_max_lag_sec;
+                if( healthy != r.healthy ){
+                    ilog("read replica ${u} ${s}, lag ${l}s",("u",r.uri)("s",healthy ? "in use" : "skipped")("l",lag));
+                }
+                r.healthy = healthy;
+            } catch (std::exception& e) {
+                if( r.healthy ) wlog("read replica ${u} unavailable: ${e}",("u",r.uri)("e",e.what()));
+                r.healthy = false;
+            }
+            return r.healthy;
+        }
+
+        // seconds behind the primary, 0 for a server that is not replicating, -1 if replication is broken
+        // (on postgresql, the age of the last replayed transaction)
+        static long long replication_lag( soci::session& sql ) {
+            const auto backend = sql.get_backend_name();
+            if( backend == "sqlite3" ) return 0;
+            if( backend == "postgresql" ){
+                long long lag = 0;
+                sql << "SELECT CAST(COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()), 0) AS BIGINT)", soci::into(lag);
+                return lag;
+            }
+
+            soci::row row;
+            sql << "SHOW SLAVE STATUS", soci::into(row);
+            if( !sql.got_data() ) return 0;
+            if( row.get_indicator("Seconds_Behind_Master") == soci::i_null ) return -1;
+
+            switch( row.get_properties("Seconds_Behind_Master").get_data_type() ){
+                case soci::dt_integer:              return row.get<int>("Seconds_Behind_Master");
+                case soci::dt_long_long:            return row.get<long long>("Seconds_Behind_Master");
+                case soci::dt_unsigned_long_long:   return row.get<unsigned long long>("Seconds_Behind_Master");
+                case soci::dt_string:               return std::stoll( row.get<std::string>("Seconds_Behind_Master") );
+                default:                            return -1;
+            }
+        }
+
+        const fc::microseconds check_interval = fc::seconds(5);
+
+        size_t m_pool_size;
+        long long m_max_lag_sec;
+        std::shared_ptr<soci_session_pool> m_primary;
+        std::vector<std::unique_ptr<replica>> m_replicas;
+        std::atomic<size_t> m_next{0};
+};
+
+} // namespace
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include <eosio/chain/types.hpp>
+#include <eosio/sql_db_plugin/lru_cache.hpp>
+
+namespace eosio {
+
+using std::string;
+
+/**
+ * Cache of rendered api responses keyed by endpoint and params.
+ *
+ * Every entry belongs to one account. Ingestion bumps a generation counter for each account an
+ * applied action touches, which invalidates that account's entries without locking; counters are
+ * hashed into a fixed table, so a collision only costs an extra miss. Entries also expire after
+ * a fixed number of blocks as a fallback for state changes ingestion cannot attribute.
+ */
+class response_cache {
+    public:
+        response_cache( size_t capacity, uint32_t ttl_blocks )
+            : m_entries(capacity), m_ttl_blocks(ttl_blocks) {
+            for( auto& g : m_generations ) g = 0;
+        }
+
+        uint32_t generation( const chain::account_name& account ) const {
+            return m_generations[ slot(account) ].load( std::memory_order_relaxed );
+        }
+
+        void touch( const chain::account_name& account ) {
+            m_generations[ slot(account) ].fetch_add( 1, std::memory_order_relaxed );
+        }
+
+        fc::optional<string> get( const string& key, uint32_t head_block_num ) {
+            auto e = m_entries.get( key );
+            if( !e ) return fc::optional<string>();
+            if( e->generation != generation(e->account) || e->block_num + m_ttl_blocks < head_block_num ){
+                m_entries.erase( key );
+                return fc::optional<string>();
+            }
+            return e->body;
+        }
+
+        // generation must be read before the response was computed
+        void put( const string& key, const chain::account_name& account, uint32_t generation, uint32_t head_block_num, const string& body ) {
+            m_entries.put( key, entry{ body, account, generation, head_block_num } );
+        }
+
+    private:
+        struct entry {
+            string               body;
+            chain::account_name  account;
+            uint32_t             generation;
+            uint32_t             block_num;
+        };
+
+        static size_t slot( const chain::account_name& account ) {
+            uint64_t h = account.value * 0x9e3779b97f4a7c15ULL;
+            return ( h >> 48 ) % generation_slots;
+        }
+
+        static constexpr size_t generation_slots = 1 << 16;
+
+        lru_cache<string, entry> m_entries;
+        uint32_t m_ttl_blocks;
+        std::array<std::atomic<uint32_t>, generation_slots> m_generations;
+};
+
+} // namespace
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <tuple>
+
+#include <soci/soci.h>
+
+#include <eosio/chain/asset.hpp>
+#include <eosio/chain/block_timestamp.hpp>
+#include <eosio/chain/types.hpp>
+#include <eosio/sql_db_plugin/apply_status.hpp>
+#include <eosio/sql_db_plugin/dead_letter.hpp>
+
+namespace eosio {
+
+using std::string;
+
+/**
+ * Hourly statistics kept next to the raw tables, so dashboards read a few rows per hour instead of
+ * grouping actions and blocks:
+ *
+ *   action_stats_hourly    stored actions per (contract, action, hour)
+ *   producer_stats_hourly  blocks and transactions per (producer, hour)
+ *   transfer_stats_hourly  transfers and volume of registered tokens per (contract, symbol, hour)
+ *
+ * Counts are summed in memory over a batch and flushed as additive upserts, so an hour spread over
+ * several batches adds up; apply_status keeps a replayed trace from adding twice. Not thread safe,
+ * it belongs to the writer.
+ */
+class rollup_tables {
+    public:
+        void load_status( soci::session& sql ) { m_status.load( sql ); }
+        // the add_ calls that follow belong to the trace ending at global_sequence, until the next call
+        void begin_trace( uint64_t global_sequence ) { m_skip = !m_status.take( global_sequence ); }
+
+        void add_action( const chain::account_name& contract, const chain::action_name& action, chain::block_timestamp_type time );
+        void add_block( const chain::account_name& producer, chain::block_timestamp_type time );
+        void add_transaction( const chain::account_name& producer, chain::block_timestamp_type time );
+        void add_transfer( const chain::account_name& contract, const chain::asset& quantity, chain::block_timestamp_type time );
+
+        bool flush( soci::session& sql );
+        // a count at a time, for a batch flush keeps failing on; counts refused on their own go to rejected
+        bool flush_apart( soci::session& sql, dead_letter& rejected );
+
+    private:
+        static long long hour_of( chain::block_timestamp_type time ) {
+            const long long sec = time.operator fc::time_point().sec_since_epoch();
+            return sec - sec % 3600;
+        }
+
+        // (contract, action, hour) -> actions
+        std::map<std::tuple<string, string, long long>, long long> m_actions;
+        // (producer, hour) -> (blocks, transactions)
+        std::map<std::pair<string, long long>, std::pair<long long, long long>> m_producers;
+        struct transfer_totals {
+            long long   transfers = 0;
+            long long   volume = 0;
+            int         precision = 0;
+        };
+        // (contract, symbol, hour) -> totals
+        std::map<std::tuple<string, string, long long>, transfer_totals> m_transfers;
+
+        apply_status m_status{"rollups"};
+        bool m_skip = false;
+};
+
+} // namespace
@@ -4,6 +4,8 @@
 #include <soci/connection-pool.h>
 #include <mysql.h>
 
+#include <eosio/sql_db_plugin/metrics.hpp>
+
 namespace eosio{
 
     class soci_session_pool {
@@ -40,6 +42,10 @@ namespace eosio{
             }
 
             void reconnect(std::shared_ptr<soci::session> sql_ptr){
+                if( sql_ptr->get_backend_name() != "mysql" ){
+                    reconnect(*sql_ptr);
+                    return;
+                }
                 soci::mysql_session_backend * mysqlBackEnd = static_cast<soci::mysql_session_backend *>(sql_ptr->get_backend());
                 int i = mysql_ping(mysqlBackEnd->conn_);
                 if(i==1){
@@ -48,7 +54,10 @@ namespace eosio{
             }
 
             std::shared_ptr<soci::session> get_session(){
+                static auto& lease_wait = metrics::instance().pool_lease_wait;
+                auto start = fc::time_point::now();
                 auto sql_ptr = std::make_shared<soci::session>(*c_pool_ptr);
+                lease_wait.observe( (fc::time_point::now() - start).count() );
                 try{// ubuntu os  try catch will lose, so direct reconnect
 
                     reconnect(sql_ptr);
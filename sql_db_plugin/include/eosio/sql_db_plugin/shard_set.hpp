@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <eosio/chain/types.hpp>
+#include <eosio/sql_db_plugin/session_pool.hpp>
+
+#include <fc/time.hpp>
+
+namespace eosio {
+
+/**
+ * The databases the actions table is spread over, one session pool each. Shard 0 is the primary
+ * database, which also holds every other table.
+ *
+ * A contract's actions, with their account_actions rows, all go to the shard its name hashes to.
+ * The hash is fixed, so the shard list of a database must not change once actions are written; the
+ * primary records it in its shards table and the writer refuses to start on a different one.
+ *
+ * Shards 1.. fail on their own: a shard that does not commit keeps its rows and is retried with the
+ * next batches, after a backoff, while the primary and the other shards move on.
+ */
+class shard_set {
+    public:
+        shard_set( std::shared_ptr<soci_session_pool> primary, const std::vector<std::string>& shard_uris, size_t pool_size ) {
+            m_pools.push_back( primary );
+            for( const auto& uri : shard_uris ){
+                m_pools.push_back( std::make_shared<soci_session_pool>( pool_size, uri ) );
+            }
+            m_retries.resize( m_pools.size() );
+        }
+
+        size_t size() const { return m_pools.size(); }
+
+        // splitmix64 finalizer, the same on every platform and build unlike std::hash
+        size_t of( const chain::account_name& contract ) const {
+            uint64_t x = contract.value;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            x = x ^ (x >> 31);
+            return x % m_pools.size();
+        }
+
+        std::shared_ptr<soci::session> get_session( size_t shard ) {
+            return m_pools.at(shard)->get_session();
+        }
+
+        // false while a failed shard waits out its backoff, so an unreachable shard does not cost every
+        // batch a connect timeout. The delay doubles from 1s up to a minute. Writer thread only
+        bool due( size_t shard ) const {
+            return fc::time_point::now() >= m_retries.at(shard).next;
+        }
+
+        void failed( size_t shard ) {
+            auto& r = m_retries.at(shard);
+            ++r.failures;
+            r.delay = fc::microseconds( std::min<int64_t>( std::max<int64_t>( r.delay.count() * 2, fc::seconds(1).count() ), fc::seconds(60).count() ) );
+            r.next = fc::time_point::now() + r.delay;
+        }
+
+        void succeeded( size_t shard ) {
+            m_retries.at(shard) = retry();
+        }
+
+        // every shard is due again, for a last try before the writer stops
+        void retry_all() {
+            for( auto& r : m_retries ) r.next = fc::time_point();
+        }
+
+        // flushes in a row the shard failed
+        uint32_t failures( size_t shard ) const { return m_retries.at(shard).failures; }
+
+        // the uri as recorded in the shards table, without its password
+        static std::string without_password( const std::string& uri ) {
+            std::string out;
+            size_t pos = 0;
+            while( pos < uri.size() ){
+                auto end = uri.find( ' ', pos );
+                if( end == std::string::npos ) end = uri.size();
+                const auto field = uri.substr( pos, end - pos );
+                if( field.compare( 0, 9, "password=" ) != 0 && field.compare( 0, 5, "pass=" ) != 0 ){
+                    if( !out.empty() && !field.empty() ) out += ' ';
+                    out += field;
+                }
+                pos = end + 1;
+            }
+            return out;
+        }
+
+        // a shard's sinks write a row at a time once it failed this many flushes in a row
+        uint32_t flush_retries = 10;
+        // rows a failing shard may hold back before they go to the dead letter file
+        size_t backlog_limit = 1000000;
+
+    private:
+        struct retry {
+            uint32_t            failures = 0;
+            fc::microseconds    delay;
+            fc::time_point      next;
+        };
+
+        std::vector<std::shared_ptr<soci_session_pool>> m_pools;
+        std::vector<retry> m_retries;
+};
+
+} // namespace
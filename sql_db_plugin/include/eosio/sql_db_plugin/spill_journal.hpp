@@ -0,0 +1,60 @@
+#pragma once
+
+#include <eosio/sql_db_plugin/trace_file.hpp>
+
+#include <boost/thread/mutex.hpp>
+
+namespace eosio {
+
+/**
+ * Traces the writer could not take yet, kept on disk in the trace_file format.
+ *
+ * The chain thread appends and the writer thread reads back in the same order; a checkpoint file
+ * records how far the writer got, so traces still in the journal when nodeos stops are written
+ * after the restart. Traces read but not yet committed when the process dies are read again.
+ *
+ * The journal is a run of segment files, dir/spill.<n>.traces. Appends go to the last one and start
+ * the next once it passes segment_size bytes; a segment is deleted as soon as everything in it is
+ * committed, so the journal shrinks while the writer is still behind.
+ */
+class spill_journal {
+    public:
+        // dir/spill.<n>.traces and dir/spill.checkpoint, created if missing
+        explicit spill_journal( const string& dir, uint64_t segment_size = 64 << 20 );
+
+        void append( const chain::transaction_trace& trace );
+
+        // traces appended and not yet read
+        size_t unread() const;
+
+        // up to max traces after the last one read, from one segment
+        vector<chain::transaction_trace_ptr> read( size_t max );
+
+        // the traces read so far are in the database; deletes the segments read to their end and
+        // empties the last one once the journal is drained
+        void commit();
+
+    private:
+        string segment_path( uint64_t segment ) const;
+        void open_reader();
+        void write_checkpoint();
+
+        const string m_dir;
+        const string m_checkpoint_path;
+        const uint64_t m_segment_size;
+        mutable boost::mutex m_mutex;
+        // segments m_first..m_last are on disk, appends go to m_last
+        uint64_t m_first = 0;
+        uint64_t m_last = 0;
+        std::unique_ptr<trace_file_writer> m_writer;
+        std::unique_ptr<trace_file_reader> m_reader;
+        uint64_t m_read_segment = 0;
+        uint64_t m_read_offset = 0;
+        uint64_t m_committed_segment = 0;
+        uint64_t m_committed = 0;
+        size_t m_unread = 0;
+        size_t m_uncommitted = 0;
+        uint64_t m_uncommitted_bytes = 0;
+};
+
+} // namespace
@@ -8,6 +8,8 @@
 #include <eosio/chain_plugin/chain_plugin.hpp>
 #include <eosio/chain/contract_table_objects.hpp>
 #include <eosio/sql_db_plugin/database.hpp>
+#include <eosio/sql_db_plugin/response_cache.hpp>
+#include <eosio/sql_db_plugin/read_pool.hpp>
 #include <appbase/application.hpp>
 #include <boost/signals2/connection.hpp>
 #include <memory>
@@ -30,9 +32,61 @@ class read_only{
         const controller& db;
         const fc::microseconds abi_serializer_max_time;
         const std::shared_ptr<sql_database> sql_db;
+        const std::shared_ptr<response_cache> cache;
+        uint32_t max_batch_size = 100;
+        std::shared_ptr<read_pool> pool;
+
+        read_only(const controller& db, const fc::microseconds& abi_serializer_max_time, const std::shared_ptr<sql_database> sql_db,
+                  const std::shared_ptr<response_cache> cache = nullptr)
+            : db(db), abi_serializer_max_time(abi_serializer_max_time),sql_db(sql_db),cache(cache) {}
+
+        // renders call(p) as json, served from the response cache while p.account is untouched
+        template<typename Params, typename Call>
+        string cached_call( const char* call_name, const Params& p, Call call )const {
+            if( !cache ) return fc::json::to_string( call(p) );
+
+            auto key = string(call_name) + fc::json::to_string(p);
+            auto head_block_num = db.head_block_num();
+            auto cached = cache->get( key, head_block_num );
+            if( cached ) return *cached;
+
+            auto generation = cache->generation( p.account );
+            auto body = fc::json::to_string( call(p) );
+            cache->put( key, p.account, generation, head_block_num, body );
+            return body;
+        }
 
-        read_only(const controller& db, const fc::microseconds& abi_serializer_max_time, const std::shared_ptr<sql_database> sql_db)
-            : db(db), abi_serializer_max_time(abi_serializer_max_time),sql_db(sql_db) {}
+        // runs query(p) on the read pool and render(p, rows) back on the application thread,
+        // where chainbase may be read; done gets the rendered json or the exception thrown
+        template<typename Params, typename Query, typename Render>
+        void async_call( const Params& p, Query query, Render render, std::function<void(std::exception_ptr, string)> done )const {
+            if( !pool ){
+                try {
+                    done( nullptr, render( p, query(p) ) );
+                } catch(...) {
+                    done( std::current_exception(), string() );
+                }
+                return;
+            }
+
+            pool->post( [p, query, render, done]() {
+                try {
+                    auto rows = std::make_shared<decltype(query(p))>( query(p) );
+                    app().get_io_service().post( [p, rows, render, done]() {
+                        try {
+                            done( nullptr, render( p, *rows ) );
+                        } catch(...) {
+                            done( std::current_exception(), string() );
+                        }
+                    });
+                } catch(...) {
+                    auto e = std::current_exception();
+                    app().get_io_service().post( [e, done]() {
+                        done( e, string() );
+                    });
+                }
+            });
+        }
 
         //get tokens
         struct token {
@@ -59,15 +113,37 @@ class read_only{
 
         get_tokens_result get_tokens( const get_tokens_params& p )const;
 
+        // balance of one token, or zero if the account has no row in the contract
+        fc::optional<token> find_token( const name& account, const token_params& t )const;
+
+        //get tokens for many accounts
+        struct get_tokens_batch_params{
+            vector<account_name> accounts;
+            vector<token_params> tokens;
+        };
+
+        struct account_tokens{
+            account_name  account;
+            vector<token> tokens;
+        };
+
+        struct get_tokens_batch_result{
+            vector<account_tokens> accounts;
+        };
+
+        get_tokens_batch_result get_tokens_batch( const get_tokens_batch_params& p )const;
+
         //get all tokens
         struct get_all_tokens_params{
             account_name account;
             int startNum = 0;
             int pageSize = 10;
+            string cursor;          // `next` of the previous page, takes precedence over startNum
         };
 
         struct get_all_tokens_result{
             vector<token> tokens;
+            string next;            // empty on the last page
         };
 
         get_all_tokens_result get_all_tokens( const get_all_tokens_params& p )const;
@@ -81,6 +157,49 @@ class read_only{
         };
 
         get_hold_tokens_result get_hold_tokens( const get_hold_tokens_params& p )const;
+        holder_index::contract_set get_hold_tokens_query( const get_hold_tokens_params& p )const;
+        get_hold_tokens_result get_hold_tokens( const get_hold_tokens_params& p, const holder_index::contract_set& contracts )const;
+
+        //get account actions, newest first
+        struct get_account_actions_params{
+            account_name    account;
+            account_name    contract;       // optional
+            name            action;         // optional, needs contract
+            uint32_t        from_block = 0;
+            uint32_t        to_block = 0;
+            fc::time_point_sec from_time;
+            fc::time_point_sec to_time;
+            string          cursor;         // `next` of the previous page
+            uint32_t        limit = 50;
+        };
+
+        struct account_action{
+            int64_t             global_sequence = 0;
+            uint32_t            block_num = 0;
+            fc::time_point_sec  block_time;
+            string              trx_id;
+            account_name        contract;
+            name                action;
+            fc::variant         authorization;
+            fc::variant         data;
+        };
+
+        struct get_account_actions_result{
+            vector<account_action> actions;
+            string      next;               // empty on the last page
+            uint32_t    head_block_num = 0; // the actions are complete up to this block
+        };
+
+        static const uint32_t max_account_actions = 1000;
+
+        account_actions_page get_account_actions_query( const get_account_actions_params& p )const;
+        get_account_actions_result get_account_actions( const get_account_actions_params& p, const account_actions_page& page )const;
+
+        // cached per contract in the token registry until the contract sets a new abi
+        bool has_accounts_table( const name& contract )const;
+
+        // token contracts the account has ever received, from the holder cache or account_tokens
+        holder_index::contract_set get_holder_contracts( const name& account )const;
 
         //get user resource
         struct get_userresource_params{
@@ -94,6 +213,22 @@ class read_only{
         };
 
         get_userresource_result get_userresource( const get_userresource_params& p )const;
+        get_userresource_result read_userresource( const abi_serializer& abis, const name& account )const;
+
+        struct get_userresource_batch_params{
+            vector<account_name> accounts;
+        };
+
+        struct account_resource{
+            account_name            account;
+            get_userresource_result resource;
+        };
+
+        struct get_userresource_batch_result{
+            vector<account_resource> resources;
+        };
+
+        get_userresource_batch_result get_userresource_batch( const get_userresource_batch_params& p )const;
 
         //get stake
         // struct get_stake_params{
@@ -166,6 +301,28 @@ class read_only{
 
         get_my_proposals_result get_my_proposals( const get_my_proposals_params& p )const;
 
+        // accounts whose permissions hold a public key, from the key cache or accounts_keys
+        struct get_key_accounts_params{
+            public_key_type public_key;
+        };
+
+        struct key_permission{
+            account_name    account;
+            permission_name permission;
+        };
+
+        struct get_key_accounts_result{
+            vector<account_name>    account_names;
+            vector<key_permission>  permissions;
+        };
+
+        get_key_accounts_result get_key_accounts( const get_key_accounts_params& p )const;
+        key_index::permissions get_key_accounts_query( const get_key_accounts_params& p )const;
+        get_key_accounts_result get_key_accounts( const get_key_accounts_params& p, const key_index::permissions& refs )const;
+
+        // renders an indexed proposal; the transaction json and status are cached back into the index
+        proposal make_proposal( const proposal_index::entry_ptr& e )const;
+
         // search info
         template<typename Function, typename Function2>
         void walk_key_value_table(const name& code, const name& scope, const name& table, Function f, Function2 f2) const;
@@ -231,14 +388,24 @@ FC_REFLECT(eosio::sql_db_apis::read_only::get_tokens_params, (account)(tokens) )
 FC_REFLECT(eosio::sql_db_apis::read_only::get_tokens_result, (tokens) )
 
 FC_REFLECT(eosio::sql_db_apis::read_only::token, (contract)(quantity)(symbol)(precision) )
-FC_REFLECT(eosio::sql_db_apis::read_only::get_all_tokens_params, (account)(startNum)(pageSize) )
-FC_REFLECT(eosio::sql_db_apis::read_only::get_all_tokens_result, (tokens) )
+FC_REFLECT(eosio::sql_db_apis::read_only::get_tokens_batch_params, (accounts)(tokens) )
+FC_REFLECT(eosio::sql_db_apis::read_only::account_tokens, (account)(tokens) )
+FC_REFLECT(eosio::sql_db_apis::read_only::get_tokens_batch_result, (accounts) )
+FC_REFLECT(eosio::sql_db_apis::read_only::get_all_tokens_params, (account)(startNum)(pageSize)(cursor) )
+FC_REFLECT(eosio::sql_db_apis::read_only::get_all_tokens_result, (tokens)(next) )
 
 FC_REFLECT(eosio::sql_db_apis::read_only::get_hold_tokens_params, (account))
 FC_REFLECT(eosio::sql_db_apis::read_only::get_hold_tokens_result, (tokens) )
 
+FC_REFLECT(eosio::sql_db_apis::read_only::get_account_actions_params, (account)(contract)(action)(from_block)(to_block)(from_time)(to_time)(cursor)(limit) )
+FC_REFLECT(eosio::sql_db_apis::read_only::account_action, (global_sequence)(block_num)(block_time)(trx_id)(contract)(action)(authorization)(data) )
+FC_REFLECT(eosio::sql_db_apis::read_only::get_account_actions_result, (actions)(next)(head_block_num) )
+
 FC_REFLECT(eosio::sql_db_apis::read_only::get_userresource_params, (account) )
 FC_REFLECT(eosio::sql_db_apis::read_only::get_userresource_result, (net_weight)(cpu_weight)(ram_bytes) )
+FC_REFLECT(eosio::sql_db_apis::read_only::get_userresource_batch_params, (accounts) )
+FC_REFLECT(eosio::sql_db_apis::read_only::account_resource, (account)(resource) )
+FC_REFLECT(eosio::sql_db_apis::read_only::get_userresource_batch_result, (resources) )
 
 FC_REFLECT(eosio::sql_db_apis::read_only::get_refund_params, (account) )
 FC_REFLECT(eosio::sql_db_apis::read_only::get_refund_result, (request_time)(net_amount)(cpu_amount) )
@@ -253,6 +420,10 @@ FC_REFLECT(eosio::sql_db_apis::read_only::get_pending_proposal_result, (proposal
 FC_REFLECT(eosio::sql_db_apis::read_only::get_my_proposals_params, (account) )
 FC_REFLECT(eosio::sql_db_apis::read_only::get_my_proposals_result, (proposals) )
 
+FC_REFLECT(eosio::sql_db_apis::read_only::get_key_accounts_params, (public_key) )
+FC_REFLECT(eosio::sql_db_apis::read_only::key_permission, (account)(permission) )
+FC_REFLECT(eosio::sql_db_apis::read_only::get_key_accounts_result, (account_names)(permissions) )
+
 
 
 
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <soci/soci.h>
+
+namespace eosio {
+
+using std::string;
+
+/**
+ * The sql that differs between the backends a session can be opened on.
+ *
+ * Statements are written once against these helpers; the backend is taken from the session,
+ * i.e. from the scheme of sql_db-uri (mysql://, postgresql://, sqlite3://).
+ */
+class sql_dialect {
+    public:
+        enum backend_type { mysql, postgresql, sqlite3 };
+
+        explicit sql_dialect( const string& backend_name )
+            : backend( backend_name == "postgresql" ? postgresql : backend_name == "sqlite3" ? sqlite3 : mysql ) {}
+
+        static sql_dialect of( soci::session& sql ) {
+            return sql_dialect( sql.get_backend_name() );
+        }
+
+        // seconds since epoch to a datetime column
+        string from_unixtime( const string& value ) const {
+            switch( backend ){
+                case postgresql:    return "to_timestamp(" + value + ")";
+                case sqlite3:       return "datetime(" + value + ", 'unixepoch')";
+                default:            return "FROM_UNIXTIME(" + value + ")";
+            }
+        }
+
+        // datetime column to seconds since epoch, as a 64 bit integer
+        string unix_timestamp( const string& column ) const {
+            switch( backend ){
+                case postgresql:    return "CAST(EXTRACT(EPOCH FROM " + column + ") AS BIGINT)";
+                case sqlite3:       return "CAST(strftime('%s', " + column + ") AS INTEGER)";
+                default:            return "CAST(UNIX_TIMESTAMP(" + column + ") AS SIGNED)";
+            }
+        }
+
+        string cast_text( const string& expr ) const {
+            switch( backend ){
+                case postgresql:    return "CAST(" + expr + " AS TEXT)";
+                case sqlite3:       return "CAST(" + expr + " AS TEXT)";
+                default:            return "CAST(" + expr + " AS CHAR)";
+            }
+        }
+
+        // the value the failed insert proposed for column, inside an upsert's update list
+        string excluded( const string& column ) const {
+            return backend == mysql ? "VALUES(" + column + ")" : "excluded." + column;
+        }
+
+        // the stored value of column, inside an upsert's update list
+        string current( const string& table, const string& column ) const {
+            return backend == mysql ? column : table + "." + column;
+        }
+
+        // the conflict clause of an upsert on the unique key `keys`
+        string on_conflict_update( const string& keys, const string& assignments ) const {
+            if( backend == mysql ) return " ON DUPLICATE KEY UPDATE " + assignments;
+            return " ON CONFLICT (" + keys + ") DO UPDATE SET " + assignments;
+        }
+
+        string insert_ignore_into() const {
+            switch( backend ){
+                case postgresql:    return "INSERT INTO ";
+                case sqlite3:       return "INSERT OR IGNORE INTO ";
+                default:            return "INSERT IGNORE INTO ";
+            }
+        }
+
+        string ignore_conflicts() const {
+            return backend == postgresql ? " ON CONFLICT DO NOTHING" : "";
+        }
+
+        // after a plain INSERT, leaves rows already stored under key as they are. Only key conflicts
+        // are skipped: unlike INSERT IGNORE, mysql still rejects values it would have to truncate
+        string keep_existing( const string& key ) const {
+            if( backend == mysql ) return " ON DUPLICATE KEY UPDATE " + key + " = " + key;
+            return " ON CONFLICT (" + key + ") DO NOTHING";
+        }
+
+        // table_values is "table(columns) VALUES (...)"
+        string upsert( const string& table_values, const string& keys, const string& assignments ) const {
+            return "INSERT INTO " + table_values + on_conflict_update( keys, assignments );
+        }
+
+        string insert_ignore( const string& table_values ) const {
+            return insert_ignore_into() + table_values + ignore_conflicts();
+        }
+
+        // for column names that are reserved words on some backend, like authorization on postgresql
+        string quote( const string& identifier ) const {
+            return backend == mysql ? "`" + identifier + "`" : "\"" + identifier + "\"";
+        }
+
+        // index hints only exist on mysql; the other planners pick the same index from the predicates
+        string force_index( const string& index ) const {
+            return backend == mysql ? " FORCE INDEX(" + index + ")" : "";
+        }
+
+        string straight_join() const {
+            return backend == mysql ? " STRAIGHT_JOIN " : " JOIN ";
+        }
+
+        const backend_type backend;
+};
+
+/**
+ * One INSERT with many VALUES tuples, bound column-wise.
+ *
+ * Each column is a vector with one value per row; the row template is the VALUES tuple with a `?`
+ * where each column's value goes, e.g. "(?, ?, FROM_UNIXTIME(?))", and the tail an optional
+ * conflict clause. Rows are sent in chunks so a statement stays below the server's packet and
+ * placeholder limits.
+ */
+class multi_row_insert {
+    public:
+        multi_row_insert( soci::session& sql, string head, string row_template, string tail = string(), size_t chunk = 500 )
+            : m_sql(sql), m_head(std::move(head)), m_row(std::move(row_template)), m_tail(std::move(tail)), m_chunk(chunk) {}
+
+        template<typename T>
+        multi_row_insert& column( const std::vector<T>& values ) {
+            m_binders.push_back( [&values]( soci::statement& st, size_t row ){ st.exchange( soci::use(values[row]) ); } );
+            m_rows = values.size();
+            return *this;
+        }
+
+        // a column that may be NULL, where indicators[row] is soci::i_null
+        template<typename T>
+        multi_row_insert& column( const std::vector<T>& values, std::vector<soci::indicator>& indicators ) {
+            m_binders.push_back( [&values, &indicators]( soci::statement& st, size_t row ){ st.exchange( soci::use(values[row], indicators[row]) ); } );
+            m_rows = values.size();
+            return *this;
+        }
+
+        void execute() {
+            for( size_t begin = 0; begin < m_rows; begin += m_chunk ){
+                const size_t end = std::min( m_rows, begin + m_chunk );
+                string sql = m_head + " VALUES ";
+                soci::statement st( m_sql );
+                for( size_t row = begin; row < end; ++row ){
+                    if( row != begin ) sql += ",";
+                    sql += placeholders( row - begin );
+                    for( const auto& bind : m_binders ) bind( st, row );
+                }
+                sql += m_tail;
+                st.alloc();
+                st.prepare( sql );
+                st.define_and_bind();
+                st.execute( true );
+            }
+        }
+
+    private:
+        string placeholders( size_t row ) const {
+            string out;
+            size_t column = 0;
+            for( char c : m_row ){
+                if( c == '?' ) out += ":c" + std::to_string(column++) + "r" + std::to_string(row);
+                else out += c;
+            }
+            return out;
+        }
+
+        soci::session& m_sql;
+        string m_head;
+        string m_row;
+        string m_tail;
+        size_t m_chunk;
+        size_t m_rows = 0;
+        std::vector<std::function<void(soci::statement&, size_t)>> m_binders;
+};
+
+} // namespace
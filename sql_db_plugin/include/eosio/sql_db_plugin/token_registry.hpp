@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include <boost/thread/shared_mutex.hpp>
+
+#include <eosio/chain/types.hpp>
+
+namespace eosio {
+
+using std::string;
+using std::vector;
+
+/**
+ * In-memory copy of the assets table.
+ *
+ * Loaded once at startup and kept current by the writer when a token `create` is stored, so the
+ * token apis never go to sql. Also caches, per contract, whether its abi declares an `accounts`
+ * table; the entry is dropped when the contract sets a new abi.
+ */
+class token_registry {
+    public:
+        struct token_info {
+            int64_t              id = 0;
+            chain::account_name  contract;
+            chain::account_name  issuer;
+            string               symbol;
+            uint8_t              precision = 0;
+        };
+
+        token_registry(){}
+
+        void add( const token_info& );
+        size_t size() const;
+
+        vector<token_info> list() const;
+        vector<token_info> page( size_t offset, size_t limit ) const;
+        vector<token_info> page_after( int64_t id, size_t limit ) const;
+        vector<token_info> find_contract( const chain::account_name& ) const;
+        fc::optional<token_info> find( const chain::account_name& contract, const string& symbol ) const;
+
+        fc::optional<bool> has_accounts_table( const chain::account_name& ) const;
+        void set_has_accounts_table( const chain::account_name&, bool );
+        void invalidate_abi( const chain::account_name& );
+
+    private:
+        typedef std::pair<chain::account_name, string> key_type;
+
+        std::map<int64_t, token_info> m_tokens;
+        std::map<key_type, int64_t> m_by_symbol;
+        std::map<chain::account_name, bool> m_accounts_table;
+        mutable boost::shared_mutex m_mutex;
+};
+
+} // namespace
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <eosio/sql_db_plugin/table.hpp>
+#include <eosio/sql_db_plugin/apply_status.hpp>
+#include <eosio/sql_db_plugin/dead_letter.hpp>
+
+#include <eosio/chain/asset.hpp>
+
+#include <map>
+#include <tuple>
+
+namespace eosio {
+
+using std::string;
+using std::vector;
+
+// eosio.token style action payloads
+struct token_transfer {
+    chain::account_name  from;
+    chain::account_name  to;
+    chain::asset         quantity;
+    string               memo;
+};
+
+struct token_issue {
+    chain::account_name  to;
+    chain::asset         quantity;
+    string               memo;
+};
+
+struct token_retire {
+    chain::asset         quantity;
+    string               memo;
+};
+
+class tokens_table : public mysql_table {
+    public:
+        tokens_table(){};
+
+        void add_holder( std::shared_ptr<soci::session>, string, string );
+        vector<string> get_holder_contracts( std::shared_ptr<soci::session>, string );
+
+        // balance and supply changes are accumulated per batch and written by flush, as increments
+        // that apply_status keeps a replayed trace from adding twice
+        void load_status( soci::session& sql ) { m_status.load( sql ); }
+        // the changes that follow belong to the trace ending at global_sequence, until the next call
+        void begin_trace( uint64_t global_sequence ) { m_skip = !m_status.take( global_sequence ); }
+        void add_balance( const chain::account_name&, const chain::account_name&, const chain::asset& );
+        void add_supply( const chain::account_name&, const chain::asset& );
+        bool flush( std::shared_ptr<soci::session> );
+        // a delta at a time, for a batch flush keeps failing on; deltas refused on their own go to rejected
+        bool flush_apart( std::shared_ptr<soci::session>, dead_letter& rejected );
+
+    private:
+        // (account, contract, symbol) -> (delta, precision)
+        std::map<std::tuple<string, string, string>, std::pair<int64_t, int>> m_balance_deltas;
+        // (contract, symbol) -> delta
+        std::map<std::pair<string, string>, int64_t> m_supply_deltas;
+        apply_status m_status{"tokens"};
+        bool m_skip = false;
+};
+
+} // namespace
+
+FC_REFLECT( eosio::token_transfer, (from)(to)(quantity)(memo) )
+FC_REFLECT( eosio::token_issue, (to)(quantity)(memo) )
+FC_REFLECT( eosio::token_retire, (quantity)(memo) )
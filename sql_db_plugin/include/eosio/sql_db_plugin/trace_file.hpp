@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <eosio/chain/trace.hpp>
+
+namespace eosio {
+
+using std::string;
+using std::vector;
+
+/**
+ * The fields of a transaction_trace the plugin consumes, in a form fc::raw can pack.
+ *
+ * except is kept as its message only (fc::exception has no binary form) and failed_dtrx_trace is
+ * dropped, nothing downstream of applied_transaction reads it.
+ */
+struct captured_trace {
+    chain::transaction_id_type                              id;
+    uint32_t                                                block_num = 0;
+    chain::block_timestamp_type                             block_time;
+    fc::optional<chain::transaction_receipt_header>         receipt;
+    fc::microseconds                                        elapsed;
+    uint64_t                                                net_usage = 0;
+    bool                                                    scheduled = false;
+    vector<chain::action_trace>                             action_traces;
+    fc::optional<string>                                    except;
+
+    captured_trace() = default;
+    explicit captured_trace( const chain::transaction_trace& t );
+
+    chain::transaction_trace_ptr to_trace() const;
+};
+
+/**
+ * Captured applied_transaction traces, one file per capture:
+ *
+ *   header   magic "EOSTRACE", uint32 version, uint32 reserved
+ *   record   uint32 size, uint32 block_num, int64 block_time (us since epoch), size bytes of packed captured_trace
+ *
+ * Little endian, no padding, records back to back, so a reader can walk a mapped file without copying
+ * and skip a record by its size alone. A file cut short by a crash ends in a partial record, which
+ * readers ignore and writers overwrite when they append to it.
+ */
+namespace trace_file {
+    const char magic[8] = { 'E', 'O', 'S', 'T', 'R', 'A', 'C', 'E' };
+    const uint32_t version = 1;
+    const size_t header_size = 16;
+    const size_t record_header_size = 16;
+
+    struct record {
+        uint32_t            block_num = 0;
+        fc::time_point      block_time;
+        const char*         data = nullptr;
+        uint32_t            size = 0;
+
+        chain::transaction_trace_ptr unpack() const;
+    };
+}
+
+class trace_file_writer {
+    public:
+        // appends to path, creating it if missing
+        explicit trace_file_writer( const string& path );
+        ~trace_file_writer();
+
+        void append( const chain::transaction_trace& trace );
+        void flush();
+
+        // drops every record, leaving only the header
+        void reset();
+
+        // bytes in the file, including the header
+        uint64_t size() const { return m_size; }
+        const string& path() const { return m_path; }
+
+    private:
+        string m_path;
+        FILE* m_file = nullptr;
+        uint64_t m_size = 0;
+        vector<char> m_buffer;
+};
+
+class trace_file_reader {
+    public:
+        explicit trace_file_reader( const string& path );
+
+        // the record at offset, false at the end of the complete records
+        bool read( uint64_t offset, trace_file::record& r ) const;
+
+        // offset of the record after the one at offset
+        static uint64_t next( uint64_t offset, const trace_file::record& r ) {
+            return offset + trace_file::record_header_size + r.size;
+        }
+
+        static uint64_t first() { return trace_file::header_size; }
+
+        // end of the last complete record
+        uint64_t end() const { return m_end; }
+        size_t count() const { return m_count; }
+
+    private:
+        boost::interprocess::file_mapping m_mapping;
+        boost::interprocess::mapped_region m_region;
+        const char* m_data = nullptr;
+        uint64_t m_size = 0;
+        uint64_t m_end = 0;
+        size_t m_count = 0;
+};
+
+} // namespace
+
+FC_REFLECT( eosio::captured_trace, (id)(block_num)(block_time)(receipt)(elapsed)(net_usage)(scheduled)(action_traces)(except) )
@@ -5,6 +5,7 @@
 
 namespace eosio {
 
+// mysql only (FROM_UNIXTIME), the block state path that used it is not connected
 class transactions_table : public mysql_table {
     public:
         transactions_table(){};
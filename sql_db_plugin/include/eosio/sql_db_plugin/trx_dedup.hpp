@@ -0,0 +1,91 @@
+#pragma once
+
+#include <deque>
+#include <unordered_set>
+#include <vector>
+
+#include <eosio/chain/types.hpp>
+
+#include <fc/time.hpp>
+
+namespace eosio {
+
+/**
+ * Transaction ids the writer has seen recently, to drop traces of transactions applied again
+ * after a fork switch or read again from the spill journal. Speculative traces never get here,
+ * the plugin only hands over the traces of accepted blocks.
+ *
+ * The last exact_window of ids, by block time, are kept exactly. Older ones are only in a pair of
+ * bloom filters covering one to two windows, which answer "maybe" and leave the final say to the
+ * caller. A transaction can only be applied until it expires, so the default window is the maximum
+ * transaction lifetime. Not thread safe, it belongs to the writer thread.
+ */
+class trx_dedup {
+    public:
+        enum verdict { fresh, duplicate, maybe };
+
+        explicit trx_dedup( fc::microseconds window, fc::microseconds exact_window = fc::seconds(120), size_t bloom_bits = size_t(1) << 25 )
+            : m_window(window), m_exact_window(std::min(exact_window, window)),
+              m_current(bloom_bits / 64), m_previous(bloom_bits / 64), m_mask(bloom_bits - 1) {}
+
+        // records id as seen at time and tells whether it was seen before
+        verdict check( const chain::transaction_id_type& id, fc::time_point time ) {
+            if( time > m_now ) m_now = time;
+            expire();
+
+            if( m_exact.count(id) ) return duplicate;
+            const bool seen = test( m_current, id ) || test( m_previous, id );
+
+            m_exact.insert( id );
+            m_order.emplace_back( m_now, id );
+            set( m_current, id );
+            return seen ? maybe : fresh;
+        }
+
+    private:
+        void expire() {
+            while( !m_order.empty() && m_order.front().first + m_exact_window < m_now ){
+                m_exact.erase( m_order.front().second );
+                m_order.pop_front();
+            }
+            if( m_generation_start + m_window < m_now ){
+                m_previous.swap( m_current );
+                std::fill( m_current.begin(), m_current.end(), 0 );
+                m_generation_start = m_now;
+            }
+        }
+
+        // the id is a sha256, its words are already uniformly distributed
+        template<typename F>
+        void for_each_bit( const chain::transaction_id_type& id, F&& f ) const {
+            const uint64_t h1 = id._hash[0];
+            const uint64_t h2 = id._hash[1] | 1;
+            for( uint64_t i = 0; i < hashes; ++i ){
+                f( (h1 + i * h2) & m_mask );
+            }
+        }
+
+        bool test( const std::vector<uint64_t>& bloom, const chain::transaction_id_type& id ) const {
+            bool all = true;
+            for_each_bit( id, [&]( uint64_t bit ){ all = all && ( bloom[bit / 64] >> (bit % 64) ) & 1; } );
+            return all;
+        }
+
+        void set( std::vector<uint64_t>& bloom, const chain::transaction_id_type& id ) {
+            for_each_bit( id, [&]( uint64_t bit ){ bloom[bit / 64] |= uint64_t(1) << (bit % 64); } );
+        }
+
+        static constexpr uint64_t hashes = 7;
+
+        const fc::microseconds m_window;
+        const fc::microseconds m_exact_window;
+        std::vector<uint64_t> m_current;
+        std::vector<uint64_t> m_previous;
+        const uint64_t m_mask;
+        fc::time_point m_generation_start;
+        fc::time_point m_now;
+        std::unordered_set<chain::transaction_id_type> m_exact;
+        std::deque<std::pair<fc::time_point, chain::transaction_id_type>> m_order;
+};
+
+} // namespace
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/asset.hpp>
+#include <eosio/chain/contract_types.hpp>
+#include <eosio/sql_db_plugin/action_data.hpp>
+#include <eosio/sql_db_plugin/tokens_table.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/reflect/reflect.hpp>
+
+namespace eosio {
+
+using std::string;
+using std::vector;
+
+// action structs of the system contract, field for field as in its abi
+struct voteproducer {
+    chain::account_name             voter;
+    chain::account_name             proxy;
+    vector<chain::account_name>     producers;
+};
+
+struct buyram {
+    chain::account_name     payer;
+    chain::account_name     receiver;
+    chain::asset            quant;
+};
+
+struct buyrambytes {
+    chain::account_name     payer;
+    chain::account_name     receiver;
+    uint32_t                bytes = 0;
+};
+
+struct sellram {
+    chain::account_name     account;
+    int64_t                 bytes = 0;
+};
+
+struct delegatebw {
+    chain::account_name     from;
+    chain::account_name     receiver;
+    chain::asset            stake_net_quantity;
+    chain::asset            stake_cpu_quantity;
+    bool                    transfer = false;
+};
+
+struct undelegatebw {
+    chain::account_name     from;
+    chain::account_name     receiver;
+    chain::asset            unstake_net_quantity;
+    chain::asset            unstake_cpu_quantity;
+};
+
+} // namespace
+
+FC_REFLECT( eosio::voteproducer, (voter)(proxy)(producers) )
+FC_REFLECT( eosio::buyram, (payer)(receiver)(quant) )
+FC_REFLECT( eosio::buyrambytes, (payer)(receiver)(bytes) )
+FC_REFLECT( eosio::sellram, (account)(bytes) )
+FC_REFLECT( eosio::delegatebw, (from)(receiver)(stake_net_quantity)(stake_cpu_quantity)(transfer) )
+FC_REFLECT( eosio::undelegatebw, (from)(receiver)(unstake_net_quantity)(unstake_cpu_quantity) )
+
+namespace eosio {
+
+/**
+ * Decoders for the high volume actions that unpack to a reflected struct and write the json of
+ * the data column directly, without abi_serializer and an fc::variant tree.
+ *
+ * The output is what binary_to_variant followed by fc::json::to_string gives for the same bytes,
+ * as long as the contract's abi declares the struct the decoder expects; matches() checks that
+ * (field names, order and types, through typedefs) and callers fall back to abi_serializer when it
+ * does not hold, e.g. for a token contract whose transfer differs from eosio.token's.
+ */
+class typed_decoder {
+    public:
+        virtual ~typed_decoder(){}
+
+        // whether the abi type of the action is the struct this decoder unpacks
+        virtual bool matches( const chain::abi_serializer& abis, const string& type ) const = 0;
+        virtual action_data decode( const chain::bytes& data ) const = 0;
+
+        // the decoder for an action name, nullptr if there is none
+        static const typed_decoder* find( chain::action_name action );
+};
+
+namespace typed_json {
+
+    template<typename T> struct tag {};
+
+    inline bool is_name_type( const string& type ) {
+        return type == "name" || type == "account_name" || type == "permission_name" || type == "action_name"
+            || type == "table_name" || type == "scope_name";
+    }
+
+    inline bool matches_builtin( const chain::abi_serializer& abis, const string& type, const char* expected ) {
+        return !abis.is_array(type) && !abis.is_struct(type) && abis.resolve_type(type) == expected;
+    }
+
+    inline bool matches( const chain::abi_serializer& abis, const string& type, tag<chain::name> ) {
+        return !abis.is_array(type) && !abis.is_struct(type) && is_name_type( abis.resolve_type(type) );
+    }
+    inline bool matches( const chain::abi_serializer& abis, const string& type, tag<chain::asset> ) { return matches_builtin( abis, type, "asset" ); }
+    inline bool matches( const chain::abi_serializer& abis, const string& type, tag<string> ) { return matches_builtin( abis, type, "string" ); }
+    inline bool matches( const chain::abi_serializer& abis, const string& type, tag<bool> ) { return matches_builtin( abis, type, "bool" ); }
+    inline bool matches( const chain::abi_serializer& abis, const string& type, tag<uint16_t> ) { return matches_builtin( abis, type, "uint16" ); }
+    inline bool matches( const chain::abi_serializer& abis, const string& type, tag<uint32_t> ) { return matches_builtin( abis, type, "uint32" ); }
+    inline bool matches( const chain::abi_serializer& abis, const string& type, tag<int64_t> ) { return matches_builtin( abis, type, "int64" ); }
+    inline bool matches( const chain::abi_serializer& abis, const string& type, tag<chain::public_key_type> ) { return matches_builtin( abis, type, "public_key" ); }
+
+    template<typename T>
+    bool matches( const chain::abi_serializer& abis, const string& type, tag<vector<T>> ) {
+        return abis.is_array(type) && matches( abis, abis.fundamental_type(type), tag<T>() );
+    }
+
+    template<typename T>
+    struct field_matcher {
+        const chain::abi_serializer& abis;
+        const chain::struct_def& def;
+        mutable size_t index = 0;
+        mutable bool ok = true;
+
+        template<typename Member, class Class, Member (Class::*member)>
+        void operator()( const char* name ) const {
+            if( !ok ) return;
+            ok = index < def.fields.size() && def.fields[index].name == name && matches( abis, def.fields[index].type, tag<Member>() );
+            ++index;
+        }
+    };
+
+    // reflected structs: same fields in the same order, no base
+    template<typename T>
+    typename std::enable_if<fc::reflector<T>::is_defined::value, bool>::type
+    matches( const chain::abi_serializer& abis, const string& type, tag<T> ) {
+        if( abis.is_array(type) || !abis.is_struct(type) ) return false;
+        const auto& def = abis.get_struct( abis.resolve_type(type) );
+        if( !def.base.empty() ) return false;
+        field_matcher<T> m{ abis, def };
+        fc::reflector<T>::visit( m );
+        return m.ok && m.index == def.fields.size();
+    }
+
+    // names, assets and keys never need escaping
+    inline void write( string& out, const chain::name& v ) { out += '"'; out += v.to_string(); out += '"'; }
+    inline void write( string& out, const chain::asset& v ) { out += '"'; out += v.to_string(); out += '"'; }
+    inline void write( string& out, const chain::public_key_type& v ) { out += '"'; out += string(v); out += '"'; }
+    inline void write( string& out, bool v ) { out += v ? "true" : "false"; }
+
+    // strings and integers go through fc's json writer for its escaping and large integer quoting
+    inline void write( string& out, const string& v ) { out += fc::json::to_string( fc::variant(v) ); }
+    inline void write( string& out, uint16_t v ) { out += std::to_string(v); }
+    inline void write( string& out, uint32_t v ) { out += fc::json::to_string( fc::variant(v) ); }
+    inline void write( string& out, int64_t v ) { out += fc::json::to_string( fc::variant(v) ); }
+
+    // nested structs (authority, key_weight...) are written by the same template as the action
+    template<typename T>
+    typename std::enable_if<fc::reflector<T>::is_defined::value>::type
+    write( string& out, const T& obj );
+
+    template<typename T>
+    void write( string& out, const vector<T>& v ) {
+        out += '[';
+        for( size_t i = 0; i < v.size(); ++i ){
+            if( i ) out += ',';
+            write( out, v[i] );
+        }
+        out += ']';
+    }
+
+    template<typename T>
+    struct field_writer {
+        const T& obj;
+        string& out;
+        mutable bool first = true;
+
+        template<typename Member, class Class, Member (Class::*member)>
+        void operator()( const char* name ) const {
+            if( !first ) out += ',';
+            first = false;
+            out += '"'; out += name; out += "\":";
+            write( out, obj.*member );
+        }
+    };
+
+    template<typename T>
+    typename std::enable_if<fc::reflector<T>::is_defined::value>::type
+    write( string& out, const T& obj ) {
+        out += '{';
+        fc::reflector<T>::visit( field_writer<T>{ obj, out } );
+        out += '}';
+    }
+
+    // the name valued fields the actions table extracts, as system_contract_arg does from a variant
+    template<typename T>
+    struct args_collector {
+        const T& obj;
+        system_contract_arg& args;
+
+        template<typename Member, class Class, Member (Class::*member)>
+        void operator()( const char* name ) const { set( name, obj.*member ); }
+
+        template<typename Value>
+        void set( const char*, const Value& ) const {}
+
+        void set( const char* name, const chain::name& v ) const {
+            const string n(name);
+            if( n == "to" ) args.to = v;
+            else if( n == "from" ) args.from = v;
+            else if( n == "receiver" ) args.receiver = v;
+            else if( n == "payer" ) args.payer = v;
+            else if( n == "name" ) args.name = v;
+            else if( n == "account" ) args.account = v;
+        }
+    };
+
+} // namespace typed_json
+
+template<typename T>
+class typed_struct_decoder : public typed_decoder {
+    public:
+        bool matches( const chain::abi_serializer& abis, const string& type ) const override {
+            return typed_json::matches( abis, type, typed_json::tag<T>() );
+        }
+
+        action_data decode( const chain::bytes& data ) const override {
+            fc::datastream<const char*> ds( data.data(), data.size() );
+            T obj;
+            fc::raw::unpack( ds, obj );
+            // anything unusual is left to abi_serializer
+            FC_ASSERT( ds.remaining() == 0, "trailing bytes after ${t}", ("t",fc::get_typename<T>::name()) );
+
+            string json;
+            json.reserve( data.size() * 3 + 64 );
+            typed_json::write( json, obj );
+
+            system_contract_arg args;
+            fc::reflector<T>::visit( typed_json::args_collector<T>{ obj, args } );
+            return action_data( std::move(json), args );
+        }
+};
+
+} // namespace
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <soci/soci.h>
+
+#include <fc/optional.hpp>
+
+#include <eosio/chain/types.hpp>
+#include <eosio/sql_db_plugin/apply_status.hpp>
+#include <eosio/sql_db_plugin/dead_letter.hpp>
+#include <eosio/sql_db_plugin/lru_cache.hpp>
+
+namespace eosio {
+
+using std::string;
+using std::vector;
+
+/**
+ * Keeps producer_tally (voters and staked weight per producer) in step with voteproducer,
+ * delegatebw and undelegatebw, so a leaderboard is an indexed read instead of parsing every
+ * votes.producers list.
+ *
+ * A voter's producers and stake are kept in voter_stakes, written in the same transaction as the
+ * deltas, and loaded when the voter is not among the cache_size most recently seen; each change
+ * applies the difference to the producers it touches. Voters changed in a batch stay out of the
+ * cache until it commits, so what is cached always matches the tables. The deltas of a batch are
+ * flushed as additive upserts and kept until they commit. Stake is what was delegated and
+ * undelegated since the voter_stakes row began, without vote decay or proxied weight, and a voter
+ * voting through a proxy counts for no producer directly.
+ *
+ * A voter whose stake is unknown, a NULL staked in voter_stakes, counts as a voter but adds no
+ * weight and its stake changes are skipped. That is every voter seeded from the votes table, and a
+ * voter undelegating more than the tally saw delegated, whose stake began before its row. Not
+ * thread safe, it belongs to the writer.
+ */
+class vote_tally {
+    public:
+        explicit vote_tally( size_t cache_size = 100000 ) : m_voters(new voter_cache(cache_size)) {}
+
+        // before the writer starts
+        void set_cache_size( size_t cache_size ) { m_voters.reset( new voter_cache(cache_size) ); }
+        void load_status( soci::session& sql ) { m_status.load( sql ); }
+        // votes and stakes that follow belong to the trace ending at global_sequence; those of a trace
+        // producer_tally already counted are ignored
+        void begin_trace( uint64_t global_sequence ) { m_skip = !m_status.take( global_sequence ); }
+
+        void vote( soci::session& sql, const chain::account_name& voter, const vector<chain::account_name>& producers );
+        void stake( soci::session& sql, const chain::account_name& voter, int64_t amount );
+
+        bool flush( soci::session& sql );
+        // a row at a time, for a batch flush keeps failing on; rows refused on their own go to rejected
+        bool flush_apart( soci::session& sql, dead_letter& rejected );
+
+    private:
+        struct voter_state {
+            std::set<chain::account_name>   producers;
+            // unset when unknown
+            fc::optional<int64_t>           staked = int64_t(0);
+        };
+        struct producer_delta {
+            long long   voters = 0;
+            long long   staked = 0;
+        };
+
+        typedef lru_cache<uint64_t, voter_state> voter_cache;
+
+        voter_state& load( soci::session& sql, const chain::account_name& voter );
+
+        // voters as of the last commit
+        std::unique_ptr<voter_cache> m_voters;
+        // voters changed in this batch, moved to m_voters once it commits
+        std::map<chain::account_name, voter_state> m_changed;
+        // producer -> change of this batch
+        std::map<string, producer_delta> m_deltas;
+        apply_status m_status{"producer_tally"};
+        bool m_skip = false;
+};
+
+} // namespace
@@ -13,6 +13,7 @@
 #include <fc/variant.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 
 namespace {
 const char* BLOCK_START_OPTION = "sql_db-block-start";
@@ -21,6 +22,21 @@ const char* SQL_DB_URI_OPTION = "sql_db-uri";
 const char* SQL_DB_ACTION_FILTER_ON = "sql_db-action-filter-on";
 const char* SQL_DB_CONTRACT_FILTER_OUT = "sql_db-contract-filter-out";
 const char* TRACE_START_OPTION = "sql_db-trace-start";
+const char* HOLDER_CACHE_SIZE_OPTION = "sql_db-holder-cache-size";
+const char* KEY_CACHE_SIZE_OPTION = "sql_db-key-cache-size";
+const char* VOTER_CACHE_SIZE_OPTION = "sql_db-voter-cache-size";
+const char* API_CACHE_SIZE_OPTION = "sql_db-api-cache-size";
+const char* API_CACHE_TTL_OPTION = "sql_db-api-cache-ttl";
+const char* API_MAX_BATCH_SIZE_OPTION = "sql_db-api-max-batch-size";
+const char* READ_THREADS_OPTION = "sql_db-read-threads";
+const char* READ_URI_OPTION = "sql_db-read-uri";
+const char* READ_MAX_LAG_OPTION = "sql_db-read-max-lag";
+const char* SINK_OPTION = "sql_db-sink";
+const char* CAPTURE_FILE_OPTION = "sql_db-capture-file";
+const char* SPILL_DIR_OPTION = "sql_db-spill-dir";
+const char* DEDUP_WINDOW_OPTION = "sql_db-dedup-window";
+const char* DEAD_LETTER_FILE_OPTION = "sql_db-dead-letter-file";
+const char* FLUSH_RETRIES_OPTION = "sql_db-flush-retries";
 }
 
 namespace fc { class variant; }
@@ -38,6 +54,10 @@ namespace eosio {
             chain_plugin* chain_plug = nullptr;
             std::shared_ptr<sql_database> sql_db;
 
+            std::shared_ptr<response_cache> api_cache;
+            uint32_t api_max_batch_size = 100;
+            std::shared_ptr<read_pool> api_read_pool;
+
             std::unique_ptr<consumer> handler;
             std::vector<std::string> contract_filter_out;
 
@@ -50,6 +70,15 @@ namespace eosio {
             void applied_irreversible_block( const chain::block_state_ptr& );
             void accepted_transaction( const chain::transaction_metadata_ptr& );
             void applied_transaction( const chain::transaction_trace_ptr& );
+            void confirm_traces( const chain::block_state_ptr& );
+
+            // traces are held until their block is accepted. A transaction applied speculatively and
+            // again in the block replaces its earlier trace, so only the in-block one is written.
+            std::map<chain::transaction_id_type, chain::transaction_trace_ptr> pending_traces;
+            chain::transaction_trace_ptr pending_onblock;
+
+            void load_proposal_index();
+            void touch_accounts( const vector<chain::action_trace>& );
 
             bool filter_out_contract( std::string contract) {
                 if( std::find(contract_filter_out.begin(),contract_filter_out.end(),contract) != contract_filter_out.end() ){
@@ -66,9 +95,112 @@ namespace eosio {
 
     void sql_db_plugin_impl::applied_transaction( const chain::transaction_trace_ptr& tc){
 
-        if(tc->action_traces.size()==1 && tc->action_traces[0].act.name.to_string() == "onblock" ) return ;
+        // failed, soft failed and delayed transactions did not execute their actions
+        if( !tc->receipt || tc->receipt->status != chain::transaction_receipt_header::executed || tc->except ){
+            metrics::instance().traces_not_executed.add();
+            return;
+        }
+
+        // onblock only feeds the producer rollups, the writer does not store it
+        if(tc->action_traces.size()==1 && tc->action_traces[0].act.name.to_string() == "onblock" ){
+            pending_onblock = tc;
+            return;
+        }
+
+        if( api_cache ) touch_accounts( tc->action_traces );
+
+        pending_traces[tc->id] = tc;
+    }
+
+    // hands the writer the traces of the block's transactions, in block order, and drops what was
+    // only applied speculatively: at or below the accepted block it can no longer be included
+    void sql_db_plugin_impl::confirm_traces( const chain::block_state_ptr& bs ) {
+        if( pending_onblock && pending_onblock->block_num == bs->block_num ){
+            handler->push_transaction_trace(pending_onblock);
+        }
+        pending_onblock.reset();
+
+        for( const auto& receipt : bs->block->transactions ){
+            const auto id = receipt.trx.contains<chain::packed_transaction>() ? receipt.trx.get<chain::packed_transaction>().id()
+                                                                              : receipt.trx.get<chain::transaction_id_type>();
+            auto itr = pending_traces.find( id );
+            if( itr == pending_traces.end() ) continue;
+            if( itr->second->block_num == bs->block_num ) handler->push_transaction_trace(itr->second);
+            pending_traces.erase( itr );
+        }
+
+        for( auto itr = pending_traces.begin(); itr != pending_traces.end(); ){
+            if( itr->second->block_num <= bs->block_num ){
+                metrics::instance().traces_duplicate.add();
+                itr = pending_traces.erase( itr );
+            } else {
+                ++itr;
+            }
+        }
+    }
 
-        handler->push_transaction_trace(tc);
+    // invalidates cached api responses of every account an action ran on, was authorized by,
+    // or, for system actions, names in its leading fields (delegatebw, buyram, sellram, refund, ...)
+    void sql_db_plugin_impl::touch_accounts( const vector<chain::action_trace>& trace ) {
+        for( const auto& atc : trace ){
+            api_cache->touch( atc.receipt.receiver );
+            for( const auto& auth : atc.act.authorization ){
+                api_cache->touch( auth.actor );
+            }
+            if( atc.act.account == chain::config::system_account_name && atc.receipt.receiver == atc.act.account ){
+                fc::datastream<const char*> ds( atc.act.data.data(), atc.act.data.size() );
+                for( int i = 0; i < 2 && ds.remaining() >= sizeof(uint64_t); ++i ){
+                    name n;
+                    fc::raw::unpack( ds, n );
+                    api_cache->touch( n );
+                }
+            }
+            touch_accounts( atc.inline_traces );
+        }
+    }
+
+    // seeds the proposal index from the eosio.msig tables; ingestion keeps it current afterwards
+    void sql_db_plugin_impl::load_proposal_index() {
+        const auto& d = chain_plug->chain().db();
+        const auto& tables = d.get_index<chain::table_id_multi_index, chain::by_code_scope_table>();
+        const auto& rows = d.get_index<chain::key_value_index, chain::by_scope_primary>();
+
+        auto for_each_row = [&]( const chain::table_id_object& t, auto f ){
+            decltype(t.id) next_tid(t.id._id + 1);
+            auto upper = rows.lower_bound(boost::make_tuple(next_tid));
+            for( auto itr = rows.lower_bound(boost::make_tuple(t.id)); itr != upper; ++itr ){
+                try {
+                    f( *itr );
+                } catch(fc::exception& e) {
+                    wlog("unable to load proposal row in ${s}: ${e}",("s",t.scope)("e",e.what()));
+                }
+            }
+        };
+
+        sql_db->m_proposal_index->clear();
+        for( auto t = tables.lower_bound(boost::make_tuple(N(eosio.msig))); t != tables.end() && t->code == N(eosio.msig); ++t ){
+            if( t->table != N(proposal) ) continue;
+            const auto* approvals = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(t->code, t->scope, N(approvals)));
+            if( approvals == nullptr ) continue;
+
+            std::map<name, transaction> trxs;
+            for_each_row( *t, [&]( const key_value_object& obj ){
+                msig_proposal_row row;
+                fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
+                fc::raw::unpack(ds, row);
+                trxs[row.proposal_name] = fc::raw::unpack<transaction>(row.packed_transaction);
+            });
+
+            for_each_row( *approvals, [&]( const key_value_object& obj ){
+                msig_approvals_row row;
+                fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
+                fc::raw::unpack(ds, row);
+                auto trx = trxs.find(row.proposal_name);
+                if( trx != trxs.end() ){
+                    sql_db->m_proposal_index->add( t->scope, row, trx->second );
+                }
+            });
+        }
     }
 
     sql_db_plugin::sql_db_plugin():my(new sql_db_plugin_impl ){}
@@ -77,7 +209,10 @@ namespace eosio {
 
     sql_db_apis::read_only  sql_db_plugin::get_read_only_api()const { 
 
-        return sql_db_apis::read_only(my->chain_plug->chain(),my->chain_plug->get_abi_serializer_max_time(),my->sql_db); 
+        sql_db_apis::read_only ro(my->chain_plug->chain(),my->chain_plug->get_abi_serializer_max_time(),my->sql_db,my->api_cache);
+        ro.max_batch_size = my->api_max_batch_size;
+        ro.pool = my->api_read_pool;
+        return ro;
     }
 
     void sql_db_plugin::set_program_options(options_description& cli, options_description& cfg) {
@@ -88,15 +223,55 @@ namespace eosio {
                 "The queue size between nodeos and SQL DB plugin thread.")
                 (BLOCK_START_OPTION, bpo::value<uint32_t>()->default_value(0),
                 "The block to start sync.")
-                (SQL_DB_URI_OPTION, bpo::value<std::string>(),
+                (SQL_DB_URI_OPTION, bpo::value<std::vector<std::string>>()->composing(),
                 "Sql DB URI connection string"
-                " If not specified then plugin is disabled. Default database 'EOS' is used if not specified in URI.")
+                " If not specified then plugin is disabled. Default database 'EOS' is used if not specified in URI."
+                " May be specified multiple times: the first is the primary database, the actions and account_actions rows are"
+                " spread over all of them by a hash of the contract. The list must not change once actions are written:"
+                " the primary records it in its shards table and the plugin refuses to start on a different one.")
                 (SQL_DB_ACTION_FILTER_ON,bpo::value<std::string>(),
                 "saved action with filter on")
                 (SQL_DB_CONTRACT_FILTER_OUT,bpo::value<std::string>(),
                 "saved action without filter out")
                 (TRACE_START_OPTION,bpo::value<std::string>()->default_value(""),
                 "The trace to start sync.")
+                (HOLDER_CACHE_SIZE_OPTION,bpo::value<uint32_t>()->default_value(100000),
+                "The number of accounts kept in the token holder cache.")
+                (KEY_CACHE_SIZE_OPTION,bpo::value<uint32_t>()->default_value(10000),
+                "The number of public keys kept in the get_key_accounts cache.")
+                (VOTER_CACHE_SIZE_OPTION,bpo::value<uint32_t>()->default_value(100000),
+                "The number of voters whose producers and stake the producer tally keeps in memory.")
+                (API_CACHE_SIZE_OPTION,bpo::value<uint32_t>()->default_value(10000),
+                "The number of api responses kept in the response cache, 0 to disable.")
+                (API_CACHE_TTL_OPTION,bpo::value<uint32_t>()->default_value(20),
+                "The number of blocks a cached api response stays valid without ingestion touching its account.")
+                (API_MAX_BATCH_SIZE_OPTION,bpo::value<uint32_t>()->default_value(100),
+                "The maximum number of accounts in one batch api request.")
+                (READ_THREADS_OPTION,bpo::value<uint32_t>()->default_value(2),
+                "The number of threads, each with its own sql session, serving api queries. 0 runs them on the http thread.")
+                (READ_URI_OPTION,bpo::value<std::vector<std::string>>()->composing(),
+                "Sql DB URI of a read replica for api queries, may be specified multiple times. Reads use sql_db-uri when no replica is usable.")
+                (READ_MAX_LAG_OPTION,bpo::value<uint32_t>()->default_value(5),
+                "The replication lag in seconds above which a read replica is skipped.")
+                (SINK_OPTION,bpo::value<std::string>()->default_value("auto"),
+                "How stored actions are written: insert (multi-row INSERT), copy (postgresql COPY), null (discard, for benchmarking)"
+                " or auto (copy on postgresql, insert otherwise).")
+                (CAPTURE_FILE_OPTION,bpo::value<std::string>(),
+                "Append every consumed transaction trace to this file, for replay with sql_db_ingest_bench --replay.")
+                (SPILL_DIR_OPTION,bpo::value<boost::filesystem::path>(),
+                "Directory of a journal for traces that do not fit sql_db-queue-size, written to the database in order once it"
+                " catches up and on the next start if nodeos stops first. Without it a full queue slows down the chain thread."
+                " Relative paths are relative to the data dir.")
+                (DEDUP_WINDOW_OPTION,bpo::value<uint32_t>()->default_value(3600),
+                "Seconds of block time a transaction id is remembered to drop traces of transactions applied again"
+                " (speculatively, then in a block, or after a fork switch). 0 writes every executed trace.")
+                (DEAD_LETTER_FILE_OPTION,bpo::value<boost::filesystem::path>()->default_value("sql_db_dead_letter.json"),
+                "File the rows the database refuses are appended to, one json object per line, instead of holding back the"
+                " rows written with them. Relative paths are relative to the data dir.")
+                (FLUSH_RETRIES_OPTION,bpo::value<uint32_t>()->default_value(10),
+                "The number of times a batch that fails to write is retried whole. After that the failing tables are written"
+                " a row at a time and the rows the database refuses go to sql_db-dead-letter-file; an unreachable database is"
+                " still waited for.")
                 ;
     }
 
@@ -115,11 +290,18 @@ namespace eosio {
             boost::split(my->contract_filter_out, fo,  boost::is_any_of( "," ));
         }
 
-        std::string uri_str = options.at(SQL_DB_URI_OPTION).as<std::string>();
-        if (uri_str.empty()){
+        my->api_max_batch_size = options.at(API_MAX_BATCH_SIZE_OPTION).as<uint32_t>();
+
+        std::vector<std::string> uris;
+        if( options.count( SQL_DB_URI_OPTION ) ){
+            uris = options.at(SQL_DB_URI_OPTION).as<std::vector<std::string>>();
+        }
+        if (uris.empty() || uris[0].empty()){
             wlog("db URI not specified => eosio::sql_db_plugin disabled.");
             return;
         }
+        std::string uri_str = uris[0];
+        const std::vector<std::string> shard_uris( uris.begin() + 1, uris.end() );
 
         ilog("connecting to ${u}", ("u", uri_str));
         uint32_t block_num_start = options.at(BLOCK_START_OPTION).as<uint32_t>();
@@ -128,8 +310,50 @@ namespace eosio {
         ilog("queue size ${size}",("size",queue_size));
 
         //for three thread。 TODO: change to thread db pool
-        my->sql_db = std::make_shared<sql_database>(uri_str, block_num_start, 1);
+        auto read_threads = options.at(READ_THREADS_OPTION).as<uint32_t>();
+        my->sql_db = std::make_shared<sql_database>(uri_str, block_num_start, std::max<uint32_t>(read_threads, 1));
+        if( !shard_uris.empty() ){
+            ilog("spreading actions over ${n} databases",("n",uris.size()));
+            my->sql_db->set_shards( shard_uris, std::max<uint32_t>(read_threads, 1) );
+        }
+        if( read_threads > 0 ){
+            my->api_read_pool = std::make_shared<read_pool>( read_threads );
+        }
+        if( options.count( READ_URI_OPTION ) ){
+            auto read_uris = options.at(READ_URI_OPTION).as<std::vector<std::string>>();
+            ilog("routing api reads to ${n} replicas",("n",read_uris.size()));
+            my->sql_db->m_read_router = std::make_shared<read_router>( read_uris, std::max<uint32_t>(read_threads, 1),
+                                            options.at(READ_MAX_LAG_OPTION).as<uint32_t>(), my->sql_db->m_session_pool );
+        }
         auto db_blocks = std::make_unique<sql_database>(uri_str, block_num_start, 5, action_filter_on,my->contract_filter_out);
+        db_blocks->set_shards( shard_uris, 5 );
+        db_blocks->check_shards( uris );
+        if( db_blocks->m_shards ) db_blocks->m_shards->flush_retries = options.at(FLUSH_RETRIES_OPTION).as<uint32_t>();
+        auto dead_letter_file = options.at(DEAD_LETTER_FILE_OPTION).as<boost::filesystem::path>();
+        if( dead_letter_file.is_relative() ) dead_letter_file = app().data_dir() / dead_letter_file;
+        db_blocks->m_dead_letter = std::make_shared<dead_letter>( dead_letter_file.string() );
+        db_blocks->set_action_sink( options.at(SINK_OPTION).as<std::string>() );
+        if( auto window = options.at(DEDUP_WINDOW_OPTION).as<uint32_t>() ){
+            db_blocks->m_dedup = std::make_unique<trx_dedup>( fc::seconds(window) );
+        }
+
+        auto proposals = std::make_shared<proposal_index>();
+        my->sql_db->m_proposal_index = proposals;
+        db_blocks->m_proposal_index = proposals;
+
+        auto tokens = std::make_shared<token_registry>();
+        my->sql_db->m_token_registry = tokens;
+        db_blocks->m_token_registry = tokens;
+        db_blocks->m_actions_table->m_token_registry = tokens;
+        db_blocks->m_actions_table->m_vote_tally.set_cache_size( options.at(VOTER_CACHE_SIZE_OPTION).as<uint32_t>() );
+
+        auto holders = std::make_shared<holder_index>( options.at(HOLDER_CACHE_SIZE_OPTION).as<uint32_t>() );
+        my->sql_db->m_holder_index = holders;
+        db_blocks->m_holder_index = holders;
+
+        auto keys = std::make_shared<key_index>( options.at(KEY_CACHE_SIZE_OPTION).as<uint32_t>() );
+        my->sql_db->m_key_index = keys;
+        db_blocks->m_key_index = keys;
 
         if (!db_blocks->is_started()) {
             if (block_num_start == 0) {
@@ -138,7 +362,27 @@ namespace eosio {
             }
         }
 
-        my->handler = std::make_unique<consumer>(std::move(db_blocks),queue_size);
+        my->sql_db->load_token_registry();
+        db_blocks->load_apply_status();
+
+        auto api_cache_size = options.at(API_CACHE_SIZE_OPTION).as<uint32_t>();
+        if( api_cache_size > 0 ){
+            my->api_cache = std::make_shared<response_cache>( api_cache_size, options.at(API_CACHE_TTL_OPTION).as<uint32_t>() );
+        }
+
+        std::unique_ptr<trace_file_writer> capture;
+        if( options.count( CAPTURE_FILE_OPTION ) ){
+            capture = std::make_unique<trace_file_writer>( options.at(CAPTURE_FILE_OPTION).as<std::string>() );
+            ilog("capturing transaction traces to ${p}",("p",capture->path()));
+        }
+        std::unique_ptr<spill_journal> spill;
+        if( options.count( SPILL_DIR_OPTION ) ){
+            auto dir = options.at(SPILL_DIR_OPTION).as<boost::filesystem::path>();
+            if( dir.is_relative() ) dir = app().data_dir() / dir;
+            spill = std::make_unique<spill_journal>( dir.string() );
+        }
+        my->handler = std::make_unique<consumer>(std::move(db_blocks),queue_size,std::move(capture),std::move(spill),
+                                                 options.at(FLUSH_RETRIES_OPTION).as<uint32_t>());
         my->chain_plug = app().find_plugin<chain_plugin>();
 
         FC_ASSERT(my->chain_plug);
@@ -149,6 +393,10 @@ namespace eosio {
         //     my->accepted_block(bs);
         // } ));
 
+        my->accepted_block_connection.emplace(chain.accepted_block.connect([this]( const chain::block_state_ptr& bs){
+            my->confirm_traces(bs);
+        } ));
+
         my->applied_transaction_connection.emplace(chain.applied_transaction.connect([this,block_num_start](const chain::transaction_trace_ptr& tt){
             if(tt->block_num < block_num_start) return;
             my->applied_transaction(tt);
@@ -158,15 +406,24 @@ namespace eosio {
 
     void sql_db_plugin::plugin_startup() {
         ilog("startup");
+        if( my->sql_db ){
+            my->load_proposal_index();
+        }
     }
 
     void sql_db_plugin::plugin_shutdown() {
         ilog("shutdown");
-        // my->handler->shutdown();
-        // my->accepted_block_connection.reset();
-        // my->irreversible_block_connection.reset();
-        // my->accepted_transaction_connection.reset();
-        // my->applied_transaction_connection.reset();
+        if( my->api_read_pool ){
+            my->api_read_pool->stop();
+        }
+        // stop the feed before draining, nothing may be queued behind the writer's last batch
+        my->accepted_block_connection.reset();
+        my->irreversible_block_connection.reset();
+        my->accepted_transaction_connection.reset();
+        my->applied_transaction_connection.reset();
+        if( my->handler ){
+            my->handler->shutdown();
+        }
     }
 
     namespace sql_db_apis{
@@ -198,6 +455,40 @@ namespace eosio {
         }
 
 
+        fc::optional<read_only::token> read_only::find_token( const name& account, const token_params& t )const {
+            fc::optional<token> result;
+
+            token tk;
+            tk.contract = t.contract;
+            tk.symbol = t.symbol;
+
+            walk_key_value_table(t.contract, account, N(accounts), [&](const key_value_object& obj){
+                EOS_ASSERT( obj.value.size() >= sizeof(asset), chain::asset_type_exception, "Invalid data on table");
+
+                asset cursor;
+                fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
+                fc::raw::unpack(ds, cursor);
+
+                EOS_ASSERT( cursor.get_symbol().valid(), chain::asset_type_exception, "Invalid asset");
+
+                if( cursor.symbol_name() == t.symbol ) {
+                    tk.quantity = asset_amount_to_string(cursor);
+                    tk.precision = cursor.decimals();
+                    result = tk;
+                }
+
+                // return false if we are looking for one and found it, true otherwise
+                return !(cursor.symbol_name() == t.symbol);
+            },[&](){
+                if( t.precision > 18 ) return ;
+                asset cursor = asset(0, chain::symbol(chain::string_to_symbol(t.precision,t.symbol.c_str())));
+                tk.quantity = asset_amount_to_string( cursor );
+                tk.precision = t.precision;
+                result = tk;
+            });
+            return result;
+        }
+
         read_only::get_tokens_result read_only::get_tokens( const get_tokens_params& p )const {
             get_tokens_result result;
 
@@ -206,34 +497,8 @@ namespace eosio {
                     const abi_def abi = get_abi( db, t.contract );
                     auto table_type = get_table_type( abi, "accounts" );
 
-                    token tk;
-                    tk.contract = t.contract;
-                    tk.symbol = t.symbol;
-
-                    walk_key_value_table(t.contract, p.account, N(accounts), [&](const key_value_object& obj){
-                        EOS_ASSERT( obj.value.size() >= sizeof(asset), chain::asset_type_exception, "Invalid data on table");
-
-                        asset cursor;
-                        fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
-                        fc::raw::unpack(ds, cursor);
-
-                        EOS_ASSERT( cursor.get_symbol().valid(), chain::asset_type_exception, "Invalid asset");
-
-                        if( cursor.symbol_name() == t.symbol ) {
-                            tk.quantity = asset_amount_to_string(cursor);
-                            tk.precision = cursor.decimals();
-                            result.tokens.emplace_back(tk);
-                        }
-
-                        // return false if we are looking for one and found it, true otherwise
-                        return !(cursor.symbol_name() == t.symbol);
-                    },[&](){
-                        if( t.precision > 18 ) return ;
-                        asset cursor = asset(0, chain::symbol(chain::string_to_symbol(t.precision,t.symbol.c_str())));
-                        tk.quantity = asset_amount_to_string( cursor );
-                        tk.precision = t.precision;
-                        result.tokens.emplace_back(tk);
-                    });
+                    auto tk = find_token( p.account, t );
+                    if( tk ) result.tokens.emplace_back(*tk);
                 } catch(fc::exception& e) {
                     wlog("${e}",("e",e.what()));
                 } catch(std::exception& e) {
@@ -245,21 +510,77 @@ namespace eosio {
             return result;
         }
 
+        // each contract is checked once for the whole batch, then every account is looked up in it
+        read_only::get_tokens_batch_result read_only::get_tokens_batch( const get_tokens_batch_params& p )const {
+            FC_ASSERT( p.accounts.size() <= max_batch_size, "too many accounts, at most ${n} per request", ("n",max_batch_size) );
+
+            get_tokens_batch_result result;
+            result.accounts.resize( p.accounts.size() );
+            for( size_t i = 0; i < p.accounts.size(); ++i ){
+                result.accounts[i].account = p.accounts[i];
+            }
+
+            for(auto t : p.tokens){
+                if( !has_accounts_table( t.contract ) ) continue;
+
+                for( size_t i = 0; i < p.accounts.size(); ++i ){
+                    try{
+                        auto tk = find_token( p.accounts[i], t );
+                        if( tk ) result.accounts[i].tokens.emplace_back(*tk);
+                    } catch(fc::exception& e) {
+                        wlog("${e}",("e",e.what()));
+                    } catch(std::exception& e) {
+                        wlog("${e}",("e",e.what()));
+                    } catch (...) {
+                        wlog("unknown");
+                    }
+                }
+            }
+            return result;
+        }
+
+        bool read_only::has_accounts_table( const name& contract )const {
+            auto cached = sql_db->m_token_registry->has_accounts_table( contract );
+            if( cached ){
+                metrics::instance().abi_cache_hits.add();
+                return *cached;
+            }
+            metrics::instance().abi_cache_misses.add();
+
+            bool found = false;
+            try{
+                const abi_def abi = get_abi( db, contract );
+                get_table_type( abi, "accounts" );
+                found = true;
+            } catch(fc::exception& e) {
+                wlog("${c}: ${e}",("c",contract)("e",e.what()));
+            }
+            sql_db->m_token_registry->set_has_accounts_table( contract, found );
+            return found;
+        }
+
         read_only::get_all_tokens_result read_only::get_all_tokens( const get_all_tokens_params& p )const {
             get_all_tokens_result result;
 
             if(p.startNum<0 || p.pageSize<0) return result;
 
-            auto assets = sql_db->m_actions_table->get_assets(sql_db->m_session_pool->get_session(), p.startNum, p.pageSize);
+            vector<token_registry::token_info> assets;
+            if( !p.cursor.empty() ){
+                assets = sql_db->m_token_registry->page_after( fc::to_int64(p.cursor), p.pageSize );
+            } else {
+                assets = sql_db->m_token_registry->page( p.startNum, p.pageSize );
+            }
+            if( p.pageSize > 0 && assets.size() == size_t(p.pageSize) ){
+                result.next = fc::to_string( assets.back().id );
+            }
 
             for(auto it = assets.begin() ; it != assets.end(); it++){
                 try{
                     token t;
-                    t.contract = it->get<string>(0);
-                    t.symbol = it->get<string>(3);
+                    t.contract = it->contract;
+                    t.symbol = it->symbol;
 
-                    const abi_def abi = get_abi( db, t.contract );
-                    auto table_type = get_table_type( abi, "accounts" );
+                    if( !has_accounts_table( t.contract ) ) continue;
 
                     walk_key_value_table(t.contract, p.account, N(accounts), [&](const key_value_object& obj){
                         EOS_ASSERT( obj.value.size() >= sizeof(asset), chain::asset_type_exception, "Invalid data on table");
@@ -280,9 +601,9 @@ namespace eosio {
                         return !(cursor.symbol_name() == t.symbol);
 
                     }, [&](){
-                        asset cursor = asset(0, chain::symbol(chain::string_to_symbol(it->get<int>(2),t.symbol.c_str())));
+                        asset cursor = asset(0, chain::symbol(chain::string_to_symbol(it->precision,t.symbol.c_str())));
                         t.quantity = asset_amount_to_string( cursor );
-                        t.precision = it->get<int>(2);
+                        t.precision = it->precision;
                         result.tokens.emplace_back(t);
                     });
                 } catch(fc::exception& e) {
@@ -298,52 +619,136 @@ namespace eosio {
             return result;
         }
 
+        holder_index::contract_set read_only::get_holder_contracts( const name& account )const {
+            auto cached = sql_db->m_holder_index->get( account );
+            if( cached ) return *cached;
+
+            auto version = sql_db->m_holder_index->version();
+            holder_index::contract_set contracts;
+            // from the primary, what a lagging replica misses would stay in the cache
+            for( const auto& c : sql_db->m_tokens_table->get_holder_contracts( sql_db->m_session_pool->get_session(), account.to_string() ) ){
+                contracts.insert( name(c) );
+            }
+            sql_db->m_holder_index->put( account, contracts, version );
+            return contracts;
+        }
+
         read_only::get_hold_tokens_result read_only::get_hold_tokens( const get_hold_tokens_params& p )const {
-            get_hold_tokens_result result;
+            return get_hold_tokens( p, get_hold_tokens_query(p) );
+        }
 
+        holder_index::contract_set read_only::get_hold_tokens_query( const get_hold_tokens_params& p )const {
+            return get_holder_contracts( p.account );
+        }
 
-            auto assets = sql_db->m_actions_table->get_assets(sql_db->m_session_pool->get_session());
+        const uint32_t read_only::max_account_actions;
+
+        account_actions_page read_only::get_account_actions_query( const get_account_actions_params& p )const {
+            FC_ASSERT( p.limit > 0 && p.limit <= max_account_actions, "limit must be between 1 and ${n}", ("n",max_account_actions) );
+            FC_ASSERT( p.action == name() || p.contract != name(), "an action filter needs a contract" );
+
+            account_actions_query q;
+            q.account = p.account.to_string();
+            if( p.contract != name() ) q.contract = p.contract.to_string();
+            if( p.action != name() ) q.name = p.action.to_string();
+            q.from_block = p.from_block;
+            q.to_block = p.to_block;
+            q.from_time = p.from_time.sec_since_epoch();
+            q.to_time = p.to_time.sec_since_epoch();
+            if( !p.cursor.empty() ) q.before = fc::to_int64( p.cursor );
+            q.limit = p.limit;
+            return sql_db->get_account_actions( q );
+        }
 
-            for(auto it = assets.begin() ; it != assets.end(); it++){
-                try{
-                    token t;
-                    t.contract = it->get<string>(0);
-                    t.symbol = it->get<string>(3);
+        read_only::get_account_actions_result read_only::get_account_actions( const get_account_actions_params& p, const account_actions_page& page )const {
+            get_account_actions_result result;
+            result.head_block_num = page.head_block_num;
+            result.actions.reserve( page.rows.size() );
+            for( const auto& row : page.rows ){
+                account_action a;
+                a.global_sequence = row.global_sequence;
+                a.block_num = row.block_num;
+                a.block_time = fc::time_point_sec( row.block_time );
+                a.trx_id = row.transaction_id;
+                a.contract = name( row.contract );
+                a.action = name( row.name );
+                try {
+                    a.authorization = fc::json::from_string( row.authorization );
+                    a.data = fc::json::from_string( row.data );
+                } catch(fc::exception& e) {
+                    a.data = row.data;
+                }
+                result.actions.emplace_back( std::move(a) );
+            }
+            if( page.rows.size() == p.limit ){
+                result.next = fc::to_string( page.rows.back().global_sequence );
+            }
+            return result;
+        }
 
-                    const abi_def abi = get_abi( db, t.contract );
-                    auto table_type = get_table_type( abi, "accounts" );
+        read_only::get_hold_tokens_result read_only::get_hold_tokens( const get_hold_tokens_params& p, const holder_index::contract_set& contracts )const {
+            get_hold_tokens_result result;
 
-                    walk_key_value_table(t.contract, p.account, N(accounts), [&](const key_value_object& obj){
-                        EOS_ASSERT( obj.value.size() >= sizeof(asset), chain::asset_type_exception, "Invalid data on table");
+            for( const auto& contract : contracts ){
+                if( !has_accounts_table( contract ) ) continue;
 
-                        asset cursor;
-                        fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
-                        fc::raw::unpack(ds, cursor);
+                auto assets = sql_db->m_token_registry->find_contract( contract );
 
-                        EOS_ASSERT( cursor.get_symbol().valid(), chain::asset_type_exception, "Invalid asset");
+                for(auto it = assets.begin() ; it != assets.end(); it++){
+                    try{
+                        token t;
+                        t.contract = it->contract;
+                        t.symbol = it->symbol;
 
-                        if( cursor.symbol_name() == t.symbol ) {
-                            t.quantity = asset_amount_to_string(cursor);
-                            t.precision = cursor.decimals();
-                            result.tokens.emplace_back(t);
-                        }
+                        walk_key_value_table(t.contract, p.account, N(accounts), [&](const key_value_object& obj){
+                            EOS_ASSERT( obj.value.size() >= sizeof(asset), chain::asset_type_exception, "Invalid data on table");
 
-                        // return false if we are looking for one and found it, true otherwise
-                        return !(cursor.symbol_name() == t.symbol);
+                            asset cursor;
+                            fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
+                            fc::raw::unpack(ds, cursor);
 
-                    }, [&](){
-                        
-                    });
-                } catch(fc::exception& e) {
-                    wlog("${e}",("e",e.what()));
-                } catch(std::exception& e) {
-                    wlog("${e}",("e",e.what()));
-                } catch (...) {
-                    wlog("unknown");
+                            EOS_ASSERT( cursor.get_symbol().valid(), chain::asset_type_exception, "Invalid asset");
+
+                            if( cursor.symbol_name() == t.symbol ) {
+                                t.quantity = asset_amount_to_string(cursor);
+                                t.precision = cursor.decimals();
+                                result.tokens.emplace_back(t);
+                            }
+
+                            // return false if we are looking for one and found it, true otherwise
+                            return !(cursor.symbol_name() == t.symbol);
+
+                        }, [&](){
+                            
+                        });
+                    } catch(fc::exception& e) {
+                        wlog("${e}",("e",e.what()));
+                    } catch(std::exception& e) {
+                        wlog("${e}",("e",e.what()));
+                    } catch (...) {
+                        wlog("unknown");
+                    }
                 }
             }
             
-            
+            return result;
+        }
+
+        read_only::get_userresource_result read_only::read_userresource( const abi_serializer& abis, const name& account )const {
+            get_userresource_result result;
+
+            walk_key_value_table(N(eosio), account, N(userres), [&](const key_value_object& obj){
+                EOS_ASSERT( obj.value.size() >= sizeof(get_userresource_result), chain::asset_type_exception, "Invalid data on table");
+
+                fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
+                auto userr = abis.binary_to_variant( "user_resources", ds, abi_serializer_max_time );
+                result.net_weight = userr["net_weight"].as<asset>();
+                result.cpu_weight = userr["cpu_weight"].as<asset>();
+                result.ram_bytes = userr["ram_bytes"].as<int64_t>();
+
+
+                return true;
+            },[&](){});
             return result;
         }
 
@@ -354,18 +759,27 @@ namespace eosio {
             const auto& code_account = db.db().get<account_object,by_name>( N(eosio) );
             if(abi_serializer::to_abi(code_account.abi, abi)){
                 abi_serializer abis( abi, abi_serializer_max_time );
-                walk_key_value_table(N(eosio), p.account, N(userres), [&](const key_value_object& obj){
-                    EOS_ASSERT( obj.value.size() >= sizeof(get_userresource_result), chain::asset_type_exception, "Invalid data on table");
+                result = read_userresource( abis, p.account );
+            }
+            return result;
+        }
 
-                    fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
-                    auto userr = abis.binary_to_variant( "user_resources", ds, abi_serializer_max_time );
-                    result.net_weight = userr["net_weight"].as<asset>();
-                    result.cpu_weight = userr["cpu_weight"].as<asset>();
-                    result.ram_bytes = userr["ram_bytes"].as<int64_t>();
+        read_only::get_userresource_batch_result read_only::get_userresource_batch( const get_userresource_batch_params& p )const {
+            FC_ASSERT( p.accounts.size() <= max_batch_size, "too many accounts, at most ${n} per request", ("n",max_batch_size) );
 
+            get_userresource_batch_result result;
 
-                    return true;
-                },[&](){});
+            abi_def abi;
+            const auto& code_account = db.db().get<account_object,by_name>( N(eosio) );
+            if(abi_serializer::to_abi(code_account.abi, abi)){
+                abi_serializer abis( abi, abi_serializer_max_time );
+                result.resources.reserve( p.accounts.size() );
+                for( const auto& account : p.accounts ){
+                    account_resource r;
+                    r.account = account;
+                    r.resource = read_userresource( abis, account );
+                    result.resources.emplace_back( std::move(r) );
+                }
             }
             return result;
         }
@@ -393,59 +807,45 @@ namespace eosio {
             return result;
         }
 
-        read_only::get_pending_proposals_result read_only::get_pending_proposals( const get_pending_proposals_params& p)const{
-            get_pending_proposals_result result;
-
-            auto proposals = sql_db->m_actions_table->get_proposal(sql_db->m_session_pool->get_session(), p.account.to_string());
+        read_only::proposal read_only::make_proposal( const proposal_index::entry_ptr& e )const{
+            proposal pro;
+            pro.proposer = e->proposer;
+            pro.proposal_name = e->proposal_name;
+            pro.requested_approvals = fc::json::to_string(e->requested_approvals);
+            pro.provided_approvals = fc::json::to_string(e->provided_approvals);
+
+            auto json = e->transaction_json;
+            if( !json ){
+                fc::variant pretty_output;
+                abi_serializer::to_variant(e->trx, pretty_output, make_resolver(this, abi_serializer_max_time), abi_serializer_max_time);
+                json = std::make_shared<const string>( fc::json::to_string(pretty_output) );
+            }
 
-            abi_def abi = get_abi(db,N(eosio.msig));
-            abi_serializer abis( abi, abi_serializer_max_time );
+            uint8_t status = 0;
+            if( e->status ){
+                status = *e->status;
+            } else {
+                try {
+                    flat_set<permission_level> provided( e->provided_approvals.begin(), e->provided_approvals.end() );
+                    db.get_authorization_manager().check_authorization(e->trx.actions,{},provided,fc::seconds(e->trx.delay_sec),[](){},false);
+                    status = 1;
+                } catch( const authorization_exception& ) {}
+            }
 
-            for(auto it = proposals.begin() ; it != proposals.end(); it++){
-                name proposer = string_to_name(it->get<string>(0).c_str());
-                name proposal_name = string_to_name(it->get<string>(1).c_str());
-                proposal pro;
-                walk_key_value_table(N(eosio.msig), proposer, N(approvals), [&](const key_value_object& obj){
-                    fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
-                    auto row = abis.binary_to_variant(abis.get_table_type(N(approvals)), ds, abi_serializer_max_time);
-                    if( row["proposal_name"].as<string>() == proposal_name.to_string() ){
-                        pro.proposer = proposer.to_string();
-                        pro.proposal_name = row["proposal_name"].as<name>();
-                        pro.transaction = "";
-                        pro.requested_approvals = fc::json::to_string(row["requested_approvals"]);
-                        pro.provided_approvals = fc::json::to_string(row["provided_approvals"]);
-
-                        walk_key_value_table(N(eosio.msig), proposer, N(proposal), [&](const key_value_object& obj){
-                            fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
-                            auto row2 = abis.binary_to_variant(abis.get_table_type(N(proposal)), ds, abi_serializer_max_time);
-                            if( row2["proposal_name"].as<string>() == proposal_name.to_string() ){
-                                auto trx_hex = row2["packed_transaction"].as_string();
-                                vector<char> trx_blob(trx_hex.size()/2);
-                                fc::from_hex(trx_hex, trx_blob.data(), trx_blob.size());
-                                transaction trx = fc::raw::unpack<transaction>(trx_blob);
-
-                                fc::variant pretty_output;
-                                abi_serializer::to_variant(trx, pretty_output, make_resolver(this, abi_serializer_max_time), abi_serializer_max_time);
-                                pro.transaction = fc::json::to_string(pretty_output);
-                                
-                                pro.status = 0;
-                                try {
-                                    db.get_authorization_manager().check_authorization(trx.actions,{},row["provided_approvals"].as<flat_set<permission_level>>(),fc::seconds(trx.delay_sec),[](){},false);
-                                    pro.status = 1;
-                                } catch( const authorization_exception& e ) {}
-                                
-                                result.proposals.emplace_back(pro);
-                                return false;
-                            }
+            if( !e->transaction_json || !e->status ){
+                sql_db->m_proposal_index->set_rendered( e, json, status );
+            }
 
-                            return true;
-                        },[&](){});
+            pro.transaction = *json;
+            pro.status = status;
+            return pro;
+        }
 
-                        return false;
-                    }
+        read_only::get_pending_proposals_result read_only::get_pending_proposals( const get_pending_proposals_params& p)const{
+            get_pending_proposals_result result;
 
-                    return true;
-                },[&](){});
+            for( const auto& e : sql_db->m_proposal_index->get_pending(p.account) ){
+                result.proposals.emplace_back( make_proposal(e) );
             }
             return result;
         }
@@ -453,101 +853,48 @@ namespace eosio {
         read_only::get_pending_proposal_result read_only::get_pending_proposal( const get_pending_proposal_params& p)const{
             get_pending_proposal_result result;
 
-            abi_def abi = get_abi(db,N(eosio.msig));
-            abi_serializer abis( abi, abi_serializer_max_time );
-
-            proposal pro;
-            walk_key_value_table(N(eosio.msig), p.proposer, N(approvals), [&](const key_value_object& obj){
-                fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
-                auto row = abis.binary_to_variant(abis.get_table_type(N(approvals)), ds, abi_serializer_max_time);
-
-                if( p.proposal_name != row["proposal_name"].as<name>() ) return true;
-
-                pro.proposer = p.proposer.to_string();
-                pro.proposal_name = row["proposal_name"].as<name>();
-                pro.transaction = "";
-                pro.requested_approvals = fc::json::to_string(row["requested_approvals"]);
-                pro.provided_approvals = fc::json::to_string(row["provided_approvals"]);
-
-                walk_key_value_table(N(eosio.msig), p.proposer, N(proposal), [&](const key_value_object& obj){
-                    fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
-                    auto row2 = abis.binary_to_variant(abis.get_table_type(N(proposal)), ds, abi_serializer_max_time);
-                    if( row2["proposal_name"].as<string>() == pro.proposal_name ){
-                        auto trx_hex = row2["packed_transaction"].as_string();
-                        vector<char> trx_blob(trx_hex.size()/2);
-                        fc::from_hex(trx_hex, trx_blob.data(), trx_blob.size());
-                        transaction trx = fc::raw::unpack<transaction>(trx_blob);
-
-                        fc::variant pretty_output;
-                        abi_serializer::to_variant(trx, pretty_output, make_resolver(this, abi_serializer_max_time), abi_serializer_max_time);
-                        pro.transaction = fc::json::to_string(pretty_output);
-
-                        pro.status = 0;
-                        try {
-                            db.get_authorization_manager().check_authorization(trx.actions,{},row["provided_approvals"].as<flat_set<permission_level>>(),fc::seconds(trx.delay_sec),[](){},false);
-                            pro.status = 1;
-                        } catch( const authorization_exception& e ) {}
-
-                        result.proposals.emplace_back(pro);
-                        return false;
-                    }
-
-                    return true;
-                },[&](){});
-
-                return true;
-            },[&](){});
-
+            auto e = sql_db->m_proposal_index->get(p.proposer, p.proposal_name);
+            if( e ){
+                result.proposals.emplace_back( make_proposal(e) );
+            }
             return result;
         }
 
         read_only::get_my_proposals_result read_only::get_my_proposals( const get_my_proposals_params& p)const{
             get_my_proposals_result result;
 
-            abi_def abi = get_abi(db,N(eosio.msig));
-            abi_serializer abis( abi, abi_serializer_max_time );
-
-            name proposer = p.account;
-            proposal pro;
-            walk_key_value_table(N(eosio.msig), proposer, N(approvals), [&](const key_value_object& obj){
-                fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
-                auto row = abis.binary_to_variant(abis.get_table_type(N(approvals)), ds, abi_serializer_max_time);
-                pro.proposer = proposer.to_string();
-                pro.proposal_name = row["proposal_name"].as<name>();
-                pro.transaction = "";
-                pro.requested_approvals = fc::json::to_string(row["requested_approvals"]);
-                pro.provided_approvals = fc::json::to_string(row["provided_approvals"]);
-
-                walk_key_value_table(N(eosio.msig), proposer, N(proposal), [&](const key_value_object& obj){
-                    fc::datastream<const char *> ds(obj.value.data(), obj.value.size());
-                    auto row2 = abis.binary_to_variant(abis.get_table_type(N(proposal)), ds, abi_serializer_max_time);
-                    if( row2["proposal_name"].as<string>() == pro.proposal_name ){
-                        auto trx_hex = row2["packed_transaction"].as_string();
-                        vector<char> trx_blob(trx_hex.size()/2);
-                        fc::from_hex(trx_hex, trx_blob.data(), trx_blob.size());
-                        transaction trx = fc::raw::unpack<transaction>(trx_blob);
-
-                        fc::variant pretty_output;
-                        abi_serializer::to_variant(trx, pretty_output, make_resolver(this, abi_serializer_max_time), abi_serializer_max_time);
-                        pro.transaction = fc::json::to_string(pretty_output);
-
-                        pro.status = 0;
-                        try {
-                            db.get_authorization_manager().check_authorization(trx.actions,{},row["provided_approvals"].as<flat_set<permission_level>>(),fc::seconds(trx.delay_sec),[](){},false);
-                            pro.status = 1;
-                        } catch( const authorization_exception& e ) {}
-
-                        result.proposals.emplace_back(pro);
-                        return false;
-                    }
+            for( const auto& e : sql_db->m_proposal_index->get_by_proposer(p.account) ){
+                result.proposals.emplace_back( make_proposal(e) );
+            }
+            return result;
+        }
 
-                    return true;
-                },[&](){});
+        read_only::get_key_accounts_result read_only::get_key_accounts( const get_key_accounts_params& p )const{
+            return get_key_accounts( p, get_key_accounts_query(p) );
+        }
 
+        key_index::permissions read_only::get_key_accounts_query( const get_key_accounts_params& p )const{
+            const string public_key = string(p.public_key);
+            auto refs = sql_db->m_key_index->get( public_key );
+            if( refs ) return *refs;
 
-                return true;
-            },[&](){});
+            auto version = sql_db->m_key_index->version();
+            key_index::permissions loaded;
+            // from the primary: a lagging replica would put rows in the cache that the version check cannot catch
+            for( const auto& r : sql_db->m_accounts_table->get_key_accounts( sql_db->m_session_pool->get_session(), public_key ) ){
+                loaded.emplace_back( name(r.first), name(r.second) );
+            }
+            sql_db->m_key_index->put( public_key, loaded, version );
+            return loaded;
+        }
 
+        // rows come sorted by account, its permissions are adjacent
+        read_only::get_key_accounts_result read_only::get_key_accounts( const get_key_accounts_params& p, const key_index::permissions& refs )const{
+            get_key_accounts_result result;
+            for( const auto& r : refs ){
+                if( result.account_names.empty() || result.account_names.back() != r.first ) result.account_names.push_back( r.first );
+                result.permissions.push_back( key_permission{ r.first, r.second } );
+            }
             return result;
         }
 
@@ -0,0 +1,153 @@
+#include <boost/test/unit_test.hpp>
+
+#include <eosio/sql_db_plugin/typed_decoders.hpp>
+#include <eosio/sql_db_plugin/abi_json_writer.hpp>
+#include <eosio/chain/eosio_contract.hpp>
+
+#include <fc/crypto/private_key.hpp>
+
+#include <limits>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+namespace {
+
+const fc::microseconds max_serialization_time = fc::microseconds(150*1000);
+
+abi_serializer make_serializer( const abi_def& abi ) {
+    abi_serializer abis;
+    abis.set_abi( abi, max_serialization_time );
+    return abis;
+}
+
+abi_def token_abi() {
+    abi_def abi;
+    abi.version = "eosio::abi/1.0";
+    abi.types.push_back( type_def{"account_name", "name"} );
+    abi.structs.push_back( struct_def{"transfer", "", {{"from", "account_name"}, {"to", "account_name"}, {"quantity", "asset"}, {"memo", "string"}}} );
+    abi.actions.push_back( action_def{N(transfer), "transfer", ""} );
+    return abi;
+}
+
+// the native abi and the system contract actions with typed decoders
+abi_def system_abi() {
+    abi_def abi = eosio_contract_abi( abi_def() );
+    abi.structs.push_back( struct_def{"voteproducer", "", {{"voter", "account_name"}, {"proxy", "account_name"}, {"producers", "account_name[]"}}} );
+    abi.structs.push_back( struct_def{"sellram", "", {{"account", "account_name"}, {"bytes", "int64"}}} );
+    abi.structs.push_back( struct_def{"delegatebw", "", {{"from", "account_name"}, {"receiver", "account_name"},
+        {"stake_net_quantity", "asset"}, {"stake_cpu_quantity", "asset"}, {"transfer", "bool"}}} );
+    abi.actions.push_back( action_def{N(voteproducer), "voteproducer", ""} );
+    abi.actions.push_back( action_def{N(sellram), "sellram", ""} );
+    abi.actions.push_back( action_def{N(delegatebw), "delegatebw", ""} );
+    return abi;
+}
+
+bool same_args( const system_contract_arg& e, const system_contract_arg& a ) {
+    return e.to == a.to && e.from == a.from && e.receiver == a.receiver
+        && e.payer == a.payer && e.name == a.name && e.account == a.account;
+}
+
+// what abi_serializer gives is the reference for the json writer and, when its abi matches, the typed decoder
+void check_action( const abi_serializer& abis, action_name name, const bytes& data, bool typed ) {
+    const auto type = abis.get_action_type( name );
+    BOOST_REQUIRE( !type.empty() );
+    const action_data expected( abis.binary_to_variant( type, data, max_serialization_time ) );
+
+    abi_json_writer writer;
+    system_contract_arg args;
+    const auto& json = writer.write( abis, type, data, &args );
+    BOOST_CHECK_EQUAL( json, expected.json() );
+    BOOST_CHECK( same_args( args, expected.args() ) );
+
+    const auto* decoder = typed_decoder::find( name );
+    BOOST_REQUIRE_EQUAL( decoder != nullptr && decoder->matches( abis, type ), typed );
+    if( !typed ) return;
+    const auto decoded = decoder->decode( data );
+    BOOST_CHECK_EQUAL( decoded.json(), expected.json() );
+    BOOST_CHECK( same_args( decoded.args(), expected.args() ) );
+}
+
+template<typename T>
+bytes pack( const T& v ) {
+    return fc::raw::pack( v );
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(decoders_test)
+
+BOOST_AUTO_TEST_CASE(transfer_max_amount)
+{
+    const auto abis = make_serializer( token_abi() );
+    const symbol sys( 4, "SYS" );
+    check_action( abis, N(transfer), pack( token_transfer{ N(alice), N(bob), asset( asset::max_amount, sys ), "max" } ), true );
+    check_action( abis, N(transfer), pack( token_transfer{ N(alice), N(bob), asset( -asset::max_amount, sys ), "" } ), true );
+    // escaping is fc's
+    check_action( abis, N(transfer), pack( token_transfer{ N(alice), N(bob), asset( 1, sys ), "quote \" slash \\ tab \t \xe4\xbd\xa0" } ), true );
+}
+
+BOOST_AUTO_TEST_CASE(int64_limits)
+{
+    const auto abis = make_serializer( system_abi() );
+    for( int64_t bytes : { int64_t(0), int64_t(0xffffffff), int64_t(0xffffffff) + 1, std::numeric_limits<int64_t>::max() } ){
+        check_action( abis, N(sellram), pack( sellram{ N(alice), bytes } ), true );
+    }
+    // fc quotes only the large positive ones
+    for( int64_t bytes : { int64_t(-1), -int64_t(0xffffffff) - 1, std::numeric_limits<int64_t>::min() } ){
+        check_action( abis, N(sellram), pack( sellram{ N(alice), bytes } ), true );
+    }
+}
+
+// an account field that is a string but not a name throws, as from_variant does, and so does one of another type
+BOOST_AUTO_TEST_CASE(args_not_names)
+{
+    abi_def abi;
+    abi.version = "eosio::abi/1.0";
+    abi.structs.push_back( struct_def{"note", "", {{"to", "string"}}} );
+    abi.structs.push_back( struct_def{"count", "", {{"account", "uint64"}}} );
+    abi.actions.push_back( action_def{N(note), "note", ""} );
+    abi.actions.push_back( action_def{N(count), "count", ""} );
+    const auto abis = make_serializer( abi );
+
+    abi_json_writer writer;
+    system_contract_arg args;
+    BOOST_CHECK_EQUAL( writer.write( abis, "note", pack( string("bob") ), &args ), "{\"to\":\"bob\"}" );
+    BOOST_CHECK( args.to == N(bob) );
+    BOOST_CHECK_THROW( writer.write( abis, "note", pack( string("Not A Name!") ), &args ), fc::exception );
+    BOOST_CHECK_THROW( writer.write( abis, "count", pack( uint64_t(5) ), &args ), fc::exception );
+}
+
+BOOST_AUTO_TEST_CASE(empty_producers)
+{
+    const auto abis = make_serializer( system_abi() );
+    check_action( abis, N(voteproducer), pack( voteproducer{ N(alice), name(), {} } ), true );
+    check_action( abis, N(voteproducer), pack( voteproducer{ N(alice), N(proxy), {} } ), true );
+    check_action( abis, N(voteproducer), pack( voteproducer{ N(alice), name(), { N(bp1), N(bp2), N(bp3) } } ), true );
+}
+
+BOOST_AUTO_TEST_CASE(system_actions)
+{
+    const auto abis = make_serializer( system_abi() );
+    const symbol sys( 4, "SYS" );
+    check_action( abis, N(delegatebw), pack( delegatebw{ N(alice), N(bob), asset( 10000, sys ), asset( 0, sys ), true } ), true );
+
+    const authority owner( public_key_type( fc::crypto::private_key::regenerate<fc::ecc::private_key_shim>( fc::sha256::hash(string("owner")) ).get_public_key() ) );
+    const authority active( 1, {}, { permission_level_weight{ permission_level{ N(bob), N(active) }, 1 } } );
+    check_action( abis, newaccount::get_name(), pack( newaccount{ N(alice), N(carol), owner, active } ), true );
+}
+
+// a transfer with a field the typed decoder does not have is left to the json writer
+BOOST_AUTO_TEST_CASE(extra_field_falls_back)
+{
+    auto abi = token_abi();
+    abi.structs[0].fields.push_back( field_def{"fee", "uint64"} );
+    const auto abis = make_serializer( abi );
+
+    bytes data = pack( token_transfer{ N(alice), N(bob), asset( 5, symbol( 4, "SYS" ) ), "fee" } );
+    const auto fee = pack( uint64_t(0x100000000) );
+    data.insert( data.end(), fee.begin(), fee.end() );
+    check_action( abis, N(transfer), data, false );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,4 +1,3 @@
-// #define BOOST_TEST_MODULE "sql_db_plugin"
-
-// #include <boost/test/unit_test.hpp>
+#define BOOST_TEST_MODULE sql_db_plugin
 
+#include <boost/test/included/unit_test.hpp>